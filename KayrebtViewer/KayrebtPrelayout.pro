@@ -0,0 +1,25 @@
+#-------------------------------------------------
+#
+# Headless tool laying out all the diagrams of a directory in advance, to fill
+# the layout cache of the viewer.
+#
+#-------------------------------------------------
+
+QT       = core
+
+TARGET = kayrebt-prelayout
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+# do not mix the object files with those of the viewer
+OBJECTS_DIR = .obj-prelayout
+MOC_DIR = .moc-prelayout
+
+include(layout.pri)
+
+SOURCES += prelayout.cpp \
+    batchlayout.cpp
+
+HEADERS += \
+    batchlayout.h
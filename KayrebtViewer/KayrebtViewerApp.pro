@@ -0,0 +1,79 @@
+#-------------------------------------------------
+#
+# Project created by QtCreator 2015-05-23T10:49:45
+#
+#-------------------------------------------------
+
+QT       += core gui sql
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
+
+TARGET = KayrebtViewer
+TEMPLATE = app
+
+include(layout.pri)
+
+
+SOURCES += main.cpp\
+    sourcetreewidget.cpp \
+    databaseviewer.cpp \
+    viewer.cpp \
+    node.cpp \
+    graph.cpp \
+    element.cpp \
+    edge.cpp \
+    drawing.cpp \
+    databasesortfilterproxymodel.cpp \
+    preferencesdialog.cpp \
+    hyperlinkactivatedevent.cpp \
+    graphitem.cpp \
+    graphitemmodel.cpp \
+    sourcetextviewer.cpp \
+    kernelcodehighlighter.cpp \
+    nodehoverevent.cpp \
+    progressscene.cpp \
+    prefetcher.cpp \
+    layeredlayout.cpp \
+    diagramstoremodel.cpp \
+    scenegeometry.cpp \
+    gridindex.cpp \
+    tilecache.cpp \
+    labelcache.cpp \
+    scenesnapshot.cpp \
+    minimap.cpp
+
+HEADERS  += \
+    sourcetreewidget.h \
+    databaseviewer.h \
+    viewer.h \
+    node.h \
+    graph.h \
+    element.h \
+    edge.h \
+    drawing.h \
+    databasesortfilterproxymodel.h \
+    preferencesdialog.h \
+    hyperlinkactivatedevent.h \
+    graphitem.h \
+    graphitemmodel.h \
+    sourcetextviewer.h \
+    kernelcodehighlighter.h \
+    nodehoverevent.h \
+    linenumberarea.h \
+    progressscene.h \
+    prefetcher.h \
+    layeredlayout.h \
+    diagramstoremodel.h \
+    scenegeometry.h \
+    gridindex.h \
+    tilecache.h \
+    labelcache.h \
+    scenesnapshot.h \
+    minimap.h
+
+FORMS    += \
+    viewer.ui \
+    preferencesdialog.ui \
+    databaseviewer.ui
+
+OTHER_FILES +=
@@ -0,0 +1,134 @@
+/**
+ * @file batchlayout.cpp
+ * @brief Implementation of class BatchLayout
+ */
+#include <cstdio>
+#include <QFile>
+#include <QStringList>
+#include "diagramstorewriter.h"
+#include "layoutjob.h"
+#include "layoutscheduler.h"
+#include "batchlayout.h"
+
+BatchLayout::BatchLayout(const QString& directory, QObject* parent) :
+	QObject(parent),
+	_directory(directory),
+	_files(directory, QStringList() << "*.dot", QDir::Files,
+		   QDirIterator::Subdirectories | QDirIterator::FollowSymlinks),
+	_out(stdout)
+{
+}
+
+BatchLayout::~BatchLayout()
+{
+	delete _pack;
+}
+
+bool BatchLayout::setPack(const QString& filename, bool withLayouts)
+{
+	delete _pack;
+	_pack = new DiagramStoreWriter(filename);
+	_layOut = withLayouts;
+	return _pack->isOk();
+}
+
+int BatchLayout::getFailures() const
+{
+	return _failures;
+}
+
+void BatchLayout::start()
+{
+	_total.start();
+	submitMore();
+}
+
+void BatchLayout::submitMore()
+{
+	LayoutScheduler& scheduler = LayoutScheduler::instance();
+	while ((!_layOut || _running.size() < scheduler.getMaxWorkers()) && _files.hasNext()) {
+		QString path = _files.next();
+		QFile file(path);
+		if (!file.open(QIODevice::ReadOnly)) {
+			_failures++;
+			_out << "FAILED    " << path << ": " << file.errorString() << endl;
+			continue;
+		}
+		QByteArray dot = file.readAll();
+
+		if (!_layOut) {
+			pack(path, dot, nullptr);
+			continue;
+		}
+
+		LayoutJob* job = scheduler.submit(dot);
+		connect(job, SIGNAL(finished()), this, SLOT(jobFinished()));
+		connect(job, SIGNAL(failed(QString)), this, SLOT(jobFailed(QString)));
+		_running.insert(job, path);
+		_timers[job].start();
+		if (_pack)
+			_texts.insert(job, dot);
+	}
+
+	if (_running.isEmpty() && !_files.hasNext())
+		finish();
+}
+
+void BatchLayout::pack(const QString& path, const QByteArray& dot, const GraphLayout* layout)
+{
+	if (!_pack)
+		return;
+	if (!_pack->add(_directory.relativeFilePath(path), dot, layout)) {
+		_failures++;
+		_out << "FAILED    " << path << ": " << _pack->errorString() << endl;
+	} else if (!_layOut) {
+		_out << "packed    " << path << endl;
+	}
+}
+
+void BatchLayout::finish()
+{
+	_out << endl;
+	if (_layOut)
+		_out << _laidOut << " diagram(s) laid out, "
+			 << _cached << " already in the cache, ";
+	if (_pack) {
+		if (_pack->commit()) {
+			_out << _pack->getEntryCount() << " diagram(s) packed, ";
+		} else {
+			_failures++;
+			_out << "the diagram store could not be written (" << _pack->errorString() << "), ";
+		}
+	}
+	_out << _failures << " failure(s), in "
+		 << _total.elapsed() / 1000.0 << " s" << endl;
+	emit done();
+}
+
+void BatchLayout::jobFinished()
+{
+	LayoutJob* job = static_cast<LayoutJob*>(sender());
+	QString path = _running.take(job);
+	qint64 elapsed = _timers.take(job).elapsed();
+	if (job->isFromCache()) {
+		_cached++;
+		_out << "cached    " << path << endl;
+	} else {
+		_laidOut++;
+		_out << "laid out  " << QString("%1 ms").arg(elapsed, 8) << "  " << path << endl;
+	}
+	pack(path, _texts.take(job), &job->getLayout());
+	submitMore();
+}
+
+void BatchLayout::jobFailed(const QString& error)
+{
+	LayoutJob* job = static_cast<LayoutJob*>(sender());
+	QString path = _running.take(job);
+	_timers.remove(job);
+	_failures++;
+	_out << "FAILED    " << path << ": " << error << endl;
+	// the viewer will report the error itself
+	pack(path, _texts.take(job), nullptr);
+	submitMore();
+}
@@ -0,0 +1,176 @@
+/**
+ * @file batchlayout.h
+ * @brief Definition of class BatchLayout
+ */
+#ifndef BATCHLAYOUT_H
+#define BATCHLAYOUT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QTextStream>
+
+class LayoutJob;
+class DiagramStoreWriter;
+class GraphLayout;
+
+/**
+ * @brief This class lays out all the diagrams of a directory tree, to fill
+ * the layout cache in advance.
+ *
+ * Diagrams are submitted to the LayoutScheduler, which runs them in parallel
+ * on all cores and stores the results in the LayoutCache. Only as many
+ * diagrams as there are workers are submitted at once, so that the time
+ * reported for each diagram is its actual layout time and so that the memory
+ * used does not depend on the number of diagrams.
+ *
+ * For each diagram, a line is printed on the standard output telling whether
+ * it was laid out (and how long it took), already in the cache, or whether
+ * its layout failed. A summary is printed at the end.
+ *
+ * The diagrams can also be packed in a diagram store (see DiagramStore), with
+ * or without their layout.
+ */
+class BatchLayout : public QObject
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * @brief Constructor.
+	 *
+	 * @param directory the root of the directory tree to explore
+	 * @param parent the parent object
+	 */
+	explicit BatchLayout(const QString& directory, QObject* parent = nullptr);
+	/**
+	 * @brief Destroys the object, discarding the diagram store if it is not
+	 * complete.
+	 */
+	~BatchLayout();
+
+	/**
+	 * @brief Packs the diagrams in a diagram store, in addition to laying
+	 * them out.
+	 *
+	 * This must be called before start().
+	 *
+	 * @param filename the store file
+	 * @param withLayouts whether the layouts are stored too, if not the
+	 * diagrams are not laid out at all
+	 *
+	 * @return true if, and only if, the store can be written
+	 */
+	bool setPack(const QString& filename, bool withLayouts);
+
+	/**
+	 * @brief Gives the number of diagrams that could not be laid out.
+	 *
+	 * @return the number of failures
+	 */
+	int getFailures() const;
+
+public slots:
+	/**
+	 * @brief Starts laying out the diagrams.
+	 */
+	void start();
+
+signals:
+	/**
+	 * @brief This signal is emitted when all diagrams have been processed.
+	 */
+	void done();
+
+private slots:
+	/**
+	 * @brief Reports a diagram laid out successfully and submits the next
+	 * one.
+	 */
+	void jobFinished();
+	/**
+	 * @brief Reports a diagram which could not be laid out and submits
+	 * the next one.
+	 *
+	 * @param error the reason of the failure
+	 */
+	void jobFailed(const QString& error);
+
+private:
+	/**
+	 * @brief Submits diagrams until all workers are busy or there are no
+	 * more diagrams, and emits done() if everything is finished.
+	 */
+	void submitMore();
+	/**
+	 * @brief Adds a diagram to the diagram store, if any.
+	 *
+	 * @param path the path of the diagram
+	 * @param dot the text of the diagram
+	 * @param layout the layout of the diagram, or nullptr if it is not to
+	 * be stored
+	 */
+	void pack(const QString& path, const QByteArray& dot, const GraphLayout* layout);
+	/**
+	 * @brief Prints the summary, completes the diagram store and emits
+	 * done().
+	 */
+	void finish();
+
+	/**
+	 * @brief the root of the directory tree
+	 */
+	QDir _directory;
+	/**
+	 * @brief the diagrams still to be submitted
+	 */
+	QDirIterator _files;
+	/**
+	 * @brief the path of the diagrams being laid out, indexed by their job
+	 */
+	QHash<LayoutJob*, QString> _running;
+	/**
+	 * @brief the time elapsed since the submission of each diagram being
+	 * laid out
+	 */
+	QHash<LayoutJob*, QElapsedTimer> _timers;
+	/**
+	 * @brief the text of the diagrams being laid out, kept only when they
+	 * are packed
+	 */
+	QHash<LayoutJob*, QByteArray> _texts;
+	/**
+	 * @brief the diagram store being written, if any
+	 */
+	DiagramStoreWriter* _pack = nullptr;
+	/**
+	 * @brief whether the diagrams are laid out
+	 */
+	bool _layOut = true;
+	/**
+	 * @brief the time elapsed since the start
+	 */
+	QElapsedTimer _total;
+	/**
+	 * @brief the number of diagrams laid out
+	 */
+	int _laidOut = 0;
+	/**
+	 * @brief the number of diagrams which were already in the cache
+	 */
+	int _cached = 0;
+	/**
+	 * @brief the number of diagrams which could not be laid out
+	 */
+	int _failures = 0;
+	/**
+	 * @brief the report output
+	 */
+	QTextStream _out;
+};
+
+#endif // BATCHLAYOUT_H
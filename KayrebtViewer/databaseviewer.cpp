@@ -8,6 +8,8 @@
 #include <QSqlDatabase>
 #include "databasesortfilterproxymodel.h"
 #include "ui_databaseviewer.h"
+#include "diagramstore.h"
+#include "diagramstoremodel.h"
 #include "graphitemmodel.h"
 #include "graphitem.h"
 #include "databaseviewer.h"
@@ -23,12 +25,18 @@ DatabaseViewer::DatabaseViewer(GraphItemModel *history, QWidget *parent) :
 	_dbBackend.setDatabaseName(dbFile);
 	_dbFilter = new DatabaseSortFilterProxyModel(this);
 
-	_fs = new QFileSystemModel(this);
-	_fs->setRootPath(QSettings().value("diagrams dir").toString());
-	_ui->fsView->setModel(_fs);
-	_ui->fsView->setRootIndex(_fs->index(_fs->rootPath()));
-	for (int col=1 ; col<_fs->columnCount() ; col++)
-		_ui->fsView->hideColumn(col);
+	// browsing the diagram store is much faster than the file system
+	if (DiagramStore::instance().isOpen()) {
+		_store = new DiagramStoreModel(DiagramStore::instance(), this);
+		_ui->fsView->setModel(_store);
+	} else {
+		_fs = new QFileSystemModel(this);
+		_fs->setRootPath(QSettings().value("diagrams dir").toString());
+		_ui->fsView->setModel(_fs);
+		_ui->fsView->setRootIndex(_fs->index(_fs->rootPath()));
+		for (int col=1 ; col<_fs->columnCount() ; col++)
+			_ui->fsView->hideColumn(col);
+	}
 	connect(_ui->fsView, SIGNAL(doubleClicked(QModelIndex)), this, SLOT(fsSymbolDoubleClicked(QModelIndex)));
 
 	if (_dbBackend.open()) {
@@ -91,16 +99,44 @@ void DatabaseViewer::symbolDoubleClicked(const QAbstractItemModel* model, const
 			model->sibling(row, 2, index).data().toString();
 	emit fileSelected(file);
 
+	QString symbol = model->sibling(row, 0, index).data().toString();
 	QString graph = settings.value("diagrams dir").toString() +
 			model->sibling(row, 1, index).data().toString() + "/" +
 			model->sibling(row, 2, index).data().toString() + "/" +
-			model->sibling(row, 0, index).data().toString() + ".dot";
+			symbol + ".dot";
+
+	// the store knows where the diagrams of the symbol are, prefer the one
+	// of the same source file
+	const DiagramStore& store = DiagramStore::instance();
+	if (store.isOpen() && store.find(graph) < 0) {
+		QList<int> entries = store.findSymbol(symbol);
+		if (!entries.isEmpty()) {
+			int entry = entries.first();
+			QString suffix = model->sibling(row, 2, index).data().toString() + "/" + symbol + ".dot";
+			for (int candidate : entries) {
+				if (store.getPath(candidate).endsWith(suffix)) {
+					entry = candidate;
+					break;
+				}
+			}
+			graph = store.getRoot() + "/" + store.getPath(entry);
+		}
+	}
 	emit graphSelected(graph);
 }
 
 void DatabaseViewer::fsSymbolDoubleClicked(const QModelIndex& index)
 {
 	QSettings settings;
+	if (_store) {
+		QString path = _store->filePath(index);
+		if (!path.isEmpty()) {
+			emit graphSelected(DiagramStore::instance().getRoot() + "/" + path);
+			emit fileSelected(settings.value("source tree").toString() + QFileInfo(path).path());
+		}
+		return;
+	}
+
 	QFileInfo file = _fs->fileInfo(index);
 	if (file.exists() && file.isFile() && file.suffix() == "dot") {
 		QString diagPath = file.canonicalFilePath();
@@ -23,6 +23,7 @@ namespace Ui {
 
 class GraphItem;
 class GraphItemModel;
+class DiagramStoreModel;
 
 /**
  * @brief This class is the left pane widget of the main view.
@@ -121,7 +122,15 @@ private:
 	 */
 	QSqlDatabase _dbBackend;
 
-	QFileSystemModel* _fs;
+	/**
+	 * @brief the model of the diagrams directory, when there is no
+	 * diagram store
+	 */
+	QFileSystemModel* _fs = nullptr;
+	/**
+	 * @brief the model of the diagram store, if there is one
+	 */
+	DiagramStoreModel* _store = nullptr;
 	/**
 	 * @brief the sorter and filter between the SQL model and the view
 	 * to enable multifiltering and sorting on the symbols
@@ -0,0 +1,290 @@
+/**
+ * @file diagramdata.h
+ * @brief Definition of class DiagramData
+ */
+#ifndef DIAGRAMDATA_H
+#define DIAGRAMDATA_H
+
+#include <QString>
+#include <QVector>
+#include "stringpool.h"
+
+/**
+ * @brief This class holds the structure and the attributes of a diagram, as
+ * read by the DotReader.
+ *
+ * The nodes and edges are stored in tables, one array per attribute, and
+ * identified by their index in the tables. Strings are stored in a
+ * StringPool. Only the attributes the viewer uses are kept, the rest of the
+ * diagram is only relevant to its layout.
+ *
+ * Nodes are stored in the order of their first appearance in the diagram,
+ * edges are grouped by tail node, and in the order of their appearance in
+ * the diagram for a given tail node. This is the order in which GraphViz
+ * iterates over them, so the tables can be matched element by element with a
+ * GraphLayout. In particular, the edges going out of a node are contiguous in
+ * the edge tables.
+ */
+class DiagramData
+{
+public:
+	/**
+	 * @brief Gives the number of nodes in the diagram.
+	 *
+	 * @return the number of nodes
+	 */
+	int getNodeCount() const { return _nodeNames.size(); }
+	/**
+	 * @brief Gives the number of edges in the diagram.
+	 *
+	 * @return the number of edges
+	 */
+	int getEdgeCount() const { return _edgeTails.size(); }
+	/**
+	 * @brief Gives the number of distinct strings in the diagram.
+	 *
+	 * @return the size of the string pool
+	 */
+	int getStringCount() const { return _strings.size(); }
+
+	/**
+	 * @brief Gives the resolution asked for by the diagram.
+	 *
+	 * @return the value of the graph attribute "dpi"
+	 */
+	qreal getDpi() const { return _dpi; }
+	/**
+	 * @brief Gives the source file containing the function represented by
+	 * the diagram.
+	 *
+	 * @return the value of the graph attribute "file"
+	 */
+	const QString& getSourceFile() const { return _strings.get(_sourceFile); }
+	/**
+	 * @brief Gives the line where the function represented by the diagram
+	 * starts.
+	 *
+	 * @return the value of the graph attribute "line"
+	 */
+	int getSourceLine() const { return _sourceLine; }
+
+	/**
+	 * @brief Gives the name of a node.
+	 *
+	 * @param node the index of the node
+	 *
+	 * @return the node identifier in the diagram
+	 */
+	const QString& getNodeName(int node) const { return _strings.get(_nodeNames[node]); }
+	/**
+	 * @brief Gives the URL of a node.
+	 *
+	 * @param node the index of the node
+	 *
+	 * @return the value of the node attribute "URL"
+	 */
+	const QString& getNodeUrl(int node) const { return _strings.get(_nodeUrls[node]); }
+	/**
+	 * @brief Gives the source file of a node.
+	 *
+	 * @param node the index of the node
+	 *
+	 * @return the value of the node attribute "filename"
+	 */
+	const QString& getNodeFile(int node) const { return _strings.get(_nodeFiles[node]); }
+	/**
+	 * @brief Gives the source line of a node.
+	 *
+	 * @param node the index of the node
+	 *
+	 * @return the value of the node attribute "line", 0 if it has none
+	 */
+	int getNodeLine(int node) const { return _nodeLines[node]; }
+	/**
+	 * @brief Gives the label of a node.
+	 *
+	 * @param node the index of the node
+	 *
+	 * @return the value of the node attribute "label", empty if it has
+	 * none, in which case the label is the node name
+	 */
+	const QString& getNodeLabel(int node) const { return _strings.get(_nodeLabels[node]); }
+	/**
+	 * @brief Gives the shape of a node.
+	 *
+	 * @param node the index of the node
+	 *
+	 * @return the value of the node attribute "shape", empty if it has
+	 * none, in which case the shape is an ellipse
+	 */
+	const QString& getNodeShape(int node) const { return _strings.get(_nodeShapes[node]); }
+	/**
+	 * @brief Gives the style of a node.
+	 *
+	 * @param node the index of the node
+	 *
+	 * @return the value of the node attribute "style"
+	 */
+	const QString& getNodeStyle(int node) const { return _strings.get(_nodeStyles[node]); }
+
+	/**
+	 * @brief Gives the tail of an edge.
+	 *
+	 * @param edge the index of the edge
+	 *
+	 * @return the index of the tail node
+	 */
+	int getEdgeTail(int edge) const { return _edgeTails[edge]; }
+	/**
+	 * @brief Gives the head of an edge.
+	 *
+	 * @param edge the index of the edge
+	 *
+	 * @return the index of the head node
+	 */
+	int getEdgeHead(int edge) const { return _edgeHeads[edge]; }
+	/**
+	 * @brief Gives the label of an edge.
+	 *
+	 * @param edge the index of the edge
+	 *
+	 * @return the value of the edge attribute "label"
+	 */
+	const QString& getEdgeLabel(int edge) const { return _strings.get(_edgeLabels[edge]); }
+	/**
+	 * @brief Gives the style of an edge.
+	 *
+	 * @param edge the index of the edge
+	 *
+	 * @return the value of the edge attribute "style"
+	 */
+	const QString& getEdgeStyle(int edge) const { return _strings.get(_edgeStyles[edge]); }
+
+	/**
+	 * @brief Gives the index of the first edge going out of a node.
+	 *
+	 * @param node the index of the node
+	 *
+	 * @return the index of the first out-edge of @p node
+	 */
+	int getOutEdgesBegin(int node) const { return _outEdgesBegin[node]; }
+	/**
+	 * @brief Gives the index following the last edge going out of a node.
+	 *
+	 * @param node the index of the node
+	 *
+	 * @return the index following the last out-edge of @p node
+	 */
+	int getOutEdgesEnd(int node) const { return _outEdgesBegin[node + 1]; }
+	/**
+	 * @brief Gives the position of the first edge coming to a node in the
+	 * list of in-edges.
+	 *
+	 * @param node the index of the node
+	 *
+	 * @return the position of the first in-edge of @p node, see
+	 * getInEdge()
+	 */
+	int getInEdgesBegin(int node) const { return _inEdgesBegin[node]; }
+	/**
+	 * @brief Gives the position following the last edge coming to a node
+	 * in the list of in-edges.
+	 *
+	 * @param node the index of the node
+	 *
+	 * @return the position following the last in-edge of @p node
+	 */
+	int getInEdgesEnd(int node) const { return _inEdgesBegin[node + 1]; }
+	/**
+	 * @brief Gives an edge from the list of in-edges, grouped by head.
+	 *
+	 * @param position the position in the list, between
+	 * getInEdgesBegin() and getInEdgesEnd() of the head
+	 *
+	 * @return the index of the edge
+	 */
+	int getInEdge(int position) const { return _inEdges[position]; }
+
+private:
+	/**
+	 * @brief the strings of the diagram
+	 */
+	StringPool _strings;
+
+	/**
+	 * @brief the graph attribute "dpi"
+	 */
+	qreal _dpi = 0;
+	/**
+	 * @brief the graph attribute "file"
+	 */
+	int _sourceFile = 0;
+	/**
+	 * @brief the graph attribute "line"
+	 */
+	int _sourceLine = 0;
+
+	/**
+	 * @brief the identifiers of the nodes
+	 */
+	QVector<int> _nodeNames;
+	/**
+	 * @brief the node attribute "URL"
+	 */
+	QVector<int> _nodeUrls;
+	/**
+	 * @brief the node attribute "filename"
+	 */
+	QVector<int> _nodeFiles;
+	/**
+	 * @brief the node attribute "line"
+	 */
+	QVector<int> _nodeLines;
+	/**
+	 * @brief the node attribute "label"
+	 */
+	QVector<int> _nodeLabels;
+	/**
+	 * @brief the node attribute "shape"
+	 */
+	QVector<int> _nodeShapes;
+	/**
+	 * @brief the node attribute "style"
+	 */
+	QVector<int> _nodeStyles;
+
+	/**
+	 * @brief the tail nodes of the edges
+	 */
+	QVector<int> _edgeTails;
+	/**
+	 * @brief the head nodes of the edges
+	 */
+	QVector<int> _edgeHeads;
+	/**
+	 * @brief the edge attribute "label"
+	 */
+	QVector<int> _edgeLabels;
+	/**
+	 * @brief the edge attribute "style"
+	 */
+	QVector<int> _edgeStyles;
+	/**
+	 * @brief the index of the first out-edge of each node, followed by
+	 * the number of edges
+	 */
+	QVector<int> _outEdgesBegin;
+	/**
+	 * @brief the position of the first in-edge of each node in @a
+	 * _inEdges, followed by the number of edges
+	 */
+	QVector<int> _inEdgesBegin;
+	/**
+	 * @brief the indices of the edges, grouped by head
+	 */
+	QVector<int> _inEdges;
+
+friend class DotReader;
+};
+
+#endif // DIAGRAMDATA_H
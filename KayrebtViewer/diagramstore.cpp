@@ -0,0 +1,207 @@
+/**
+ * @file diagramstore.cpp
+ * @brief Implementation of class DiagramStore
+ */
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSettings>
+#include "diagramstore.h"
+
+const char* const DiagramStore::DEFAULT_FILENAME = "diagrams.kds";
+const quint32 DiagramStore::MAGIC = 0x4b445331; // "KDS1"
+const quint16 DiagramStore::FORMAT_VERSION = 1;
+
+DiagramStore& DiagramStore::instance()
+{
+	// the store is also used by the Prefetcher, from a worker thread
+	static DiagramStore* store = openConfigured();
+	return *store;
+}
+
+DiagramStore* DiagramStore::openConfigured()
+{
+	QSettings settings;
+	QString root = settings.value("diagrams dir").toString();
+	QString filename = settings.value("diagram store").toString();
+	if (filename.isEmpty() && !root.isEmpty())
+		filename = QDir(root).filePath(DEFAULT_FILENAME);
+	return new DiagramStore(filename, root);
+}
+
+QString DiagramStore::layoutSignature()
+{
+	return QString("%1;%2;%3")
+			.arg(GraphLayout::DOT_DEFAULT_DPI)
+			.arg(GraphLayout::FONT_FAMILY)
+			.arg(GraphLayout::FONT_POINT_SIZE);
+}
+
+DiagramStore::DiagramStore(const QString& filename, const QString& root) :
+	_file(filename),
+	_root(QDir::cleanPath(QDir(root).absolutePath()))
+{
+	if (filename.isEmpty() || !QFileInfo(filename).exists())
+		return;
+	if (!open()) {
+		qWarning() << "Couldn't open the diagram store" << filename;
+		close();
+	}
+}
+
+DiagramStore::~DiagramStore()
+{
+	close();
+}
+
+bool DiagramStore::open()
+{
+	if (!_file.open(QIODevice::ReadOnly) || _file.size() == 0)
+		return false;
+	_size = _file.size();
+	_mapped = _file.map(0, _size);
+	if (!_mapped)
+		return false;
+	_modified = QFileInfo(_file).lastModified();
+
+	QByteArray content = QByteArray::fromRawData(reinterpret_cast<const char*>(_mapped), _size);
+	QDataStream header(content);
+	header.setVersion(QDataStream::Qt_4_8);
+	quint32 magic;
+	quint16 version;
+	quint64 indexOffset;
+	header >> magic >> version >> indexOffset;
+	if (header.status() != QDataStream::Ok || magic != MAGIC ||
+		version != FORMAT_VERSION || indexOffset >= quint64(content.size()))
+		return false;
+
+	QDataStream index(bytes(indexOffset, content.size() - indexOffset));
+	index.setVersion(QDataStream::Qt_4_8);
+	QString signature;
+	quint32 count;
+	index >> signature >> count;
+	if (index.status() != QDataStream::Ok || count > quint64(content.size()))
+		return false;
+	_layoutsValid = signature == layoutSignature();
+	_entries.reserve(count);
+	_byPath.reserve(count);
+	for (quint32 i = 0 ; i < count && index.status() == QDataStream::Ok ; i++) {
+		Entry entry;
+		QString symbol;
+		index >> entry.path >> symbol >> entry.dotOffset >> entry.dotSize >> entry.dotCompressed
+			  >> entry.layoutOffset >> entry.layoutSize;
+		_byPath.insert(entry.path, _entries.size());
+		_bySymbol.insert(symbol, _entries.size());
+		_entries.append(entry);
+	}
+	return index.status() == QDataStream::Ok;
+}
+
+void DiagramStore::close()
+{
+	_entries.clear();
+	_byPath.clear();
+	_bySymbol.clear();
+	if (_mapped) {
+		_file.unmap(_mapped);
+		_size = 0;
+		_mapped = nullptr;
+	}
+	_file.close();
+}
+
+bool DiagramStore::isOpen() const
+{
+	return _mapped != nullptr;
+}
+
+const QString& DiagramStore::getRoot() const
+{
+	return _root;
+}
+
+int DiagramStore::getEntryCount() const
+{
+	return _entries.size();
+}
+
+const QString& DiagramStore::getPath(int entry) const
+{
+	return _entries[entry].path;
+}
+
+QString DiagramStore::relativePath(const QString& path) const
+{
+	if (QDir::isRelativePath(path))
+		return QDir::cleanPath(path);
+	QString clean = QDir::cleanPath(path);
+	if (!clean.startsWith(_root + "/"))
+		return QString();
+	return clean.mid(_root.size() + 1);
+}
+
+int DiagramStore::find(const QString& path) const
+{
+	if (_entries.isEmpty())
+		return -1;
+	return _byPath.value(relativePath(path), -1);
+}
+
+QList<int> DiagramStore::findSymbol(const QString& symbol) const
+{
+	return _bySymbol.values(symbol);
+}
+
+QByteArray DiagramStore::bytes(quint64 offset, quint32 size) const
+{
+	if (!_mapped || offset + size > quint64(_size))
+		return QByteArray();
+	return QByteArray::fromRawData(reinterpret_cast<const char*>(_mapped + offset), size);
+}
+
+QByteArray DiagramStore::readDot(int entry) const
+{
+	const Entry& e = _entries[entry];
+	QByteArray dot = bytes(e.dotOffset, e.dotSize);
+	return e.dotCompressed ? qUncompress(dot) : dot;
+}
+
+bool DiagramStore::readLayout(int entry, GraphLayout& layout) const
+{
+	const Entry& e = _entries[entry];
+	if (!_layoutsValid || e.layoutSize == 0)
+		return false;
+
+	QByteArray data = qUncompress(bytes(e.layoutOffset, e.layoutSize));
+	QDataStream in(data);
+	in.setVersion(QDataStream::Qt_4_8);
+	in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+	GraphLayout result;
+	in >> result;
+	if (in.status() != QDataStream::Ok)
+		return false;
+
+	layout = result;
+	return true;
+}
+
+bool DiagramStore::exists(const QString& path) const
+{
+	return find(path) >= 0 || QFileInfo(path).exists();
+}
+
+QString DiagramStore::canonicalPath(const QString& path) const
+{
+	int entry = find(path);
+	if (entry >= 0)
+		return _root + "/" + _entries[entry].path;
+	return QFileInfo(path).canonicalFilePath();
+}
+
+QDateTime DiagramStore::lastModified(const QString& path) const
+{
+	if (find(path) >= 0)
+		return _modified;
+	return QFileInfo(path).lastModified();
+}
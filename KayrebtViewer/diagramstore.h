@@ -0,0 +1,293 @@
+/**
+ * @file diagramstore.h
+ * @brief Definition of class DiagramStore
+ */
+#ifndef DIAGRAMSTORE_H
+#define DIAGRAMSTORE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include "graphlayout.h"
+
+/**
+ * @brief This class gives access to a packed diagram store, a single file
+ * holding all the diagrams of a diagrams directory.
+ *
+ * Reading tens of thousands of small files is dominated by the file system
+ * overhead, a store is opened once, mapped in memory, and its diagrams are
+ * read from there. Each diagram is compressed, unless compression does not
+ * make it smaller, and may come with its layout, computed in advance. The
+ * store has an index of the diagrams by path (relative to the diagrams
+ * directory) and by symbol (the name of the function the diagram represents).
+ *
+ * Diagrams are designated by their path in the diagrams directory, as if they
+ * were loose files. When a diagram is not in the store, or when there is no
+ * store, the loose file is used.
+ *
+ * The store file is given by setting "diagram store", it defaults to
+ * DEFAULT_FILENAME in the diagrams directory. Stores are written by
+ * DiagramStoreWriter.
+ *
+ * Once open, a store is never modified, all the const functions can be called
+ * from any thread.
+ */
+class DiagramStore
+{
+public:
+	/**
+	 * @brief the name of the store file in the diagrams directory, when
+	 * setting "diagram store" is not set
+	 */
+	static const char* const DEFAULT_FILENAME;
+	/**
+	 * @brief the magic number at the beginning of a store
+	 */
+	static const quint32 MAGIC;
+	/**
+	 * @brief the version of the store format
+	 */
+	static const quint16 FORMAT_VERSION;
+
+	/**
+	 * @brief Gives the store configured in the settings, opening it if
+	 * necessary.
+	 *
+	 * @return the store, which may be closed if there is none
+	 */
+	static DiagramStore& instance();
+	/**
+	 * @brief Gives a string identifying the settings on which the layouts
+	 * depend.
+	 *
+	 * The layouts of a store are ignored if they were computed with
+	 * different settings.
+	 *
+	 * @return the signature of the layout settings
+	 */
+	static QString layoutSignature();
+
+	/**
+	 * @brief Constructor. Opens a store.
+	 *
+	 * If the store cannot be opened, the object is valid but closed, and
+	 * contains no diagram.
+	 *
+	 * @param filename the store file
+	 * @param root the diagrams directory the paths of the store are
+	 * relative to
+	 */
+	DiagramStore(const QString& filename, const QString& root);
+	/**
+	 * @brief Closes the store.
+	 */
+	~DiagramStore();
+
+	/**
+	 * @brief Tells whether the store is open.
+	 *
+	 * @return true if, and only if, the store file could be read
+	 */
+	bool isOpen() const;
+	/**
+	 * @brief Gives the diagrams directory the paths of the store are
+	 * relative to.
+	 *
+	 * @return the diagrams directory, without a trailing slash
+	 */
+	const QString& getRoot() const;
+	/**
+	 * @brief Gives the number of diagrams in the store.
+	 *
+	 * @return the number of entries
+	 */
+	int getEntryCount() const;
+	/**
+	 * @brief Gives the path of a diagram in the store.
+	 *
+	 * @param entry the index of the diagram
+	 *
+	 * @return the path of the diagram, relative to the diagrams directory
+	 */
+	const QString& getPath(int entry) const;
+	/**
+	 * @brief Looks for a diagram by path.
+	 *
+	 * @param path the path of the diagram, absolute or relative to the
+	 * diagrams directory
+	 *
+	 * @return the index of the diagram, or -1 if it is not in the store
+	 */
+	int find(const QString& path) const;
+	/**
+	 * @brief Looks for the diagrams of a function.
+	 *
+	 * @param symbol the name of the function
+	 *
+	 * @return the indices of the diagrams of functions named @p symbol
+	 */
+	QList<int> findSymbol(const QString& symbol) const;
+	/**
+	 * @brief Reads a diagram.
+	 *
+	 * @param entry the index of the diagram
+	 *
+	 * @return the text of the diagram, in dot format, which may point
+	 * directly into the store mapped in memory
+	 */
+	QByteArray readDot(int entry) const;
+	/**
+	 * @brief Reads the layout of a diagram, if the store has it.
+	 *
+	 * @param entry the index of the diagram
+	 * @param layout receives the layout
+	 *
+	 * @return true if, and only if, the store has a valid layout for the
+	 * diagram
+	 */
+	bool readLayout(int entry, GraphLayout& layout) const;
+
+	/**
+	 * @brief Tells whether a diagram exists, in the store or as a loose
+	 * file.
+	 *
+	 * @param path the path of the diagram
+	 *
+	 * @return true if, and only if, the diagram can be read
+	 */
+	bool exists(const QString& path) const;
+	/**
+	 * @brief Gives a unique path for a diagram, suitable to compare
+	 * diagrams and to index them.
+	 *
+	 * @param path the path of the diagram
+	 *
+	 * @return the canonical path of the diagram, or an empty string if it
+	 * does not exist
+	 */
+	QString canonicalPath(const QString& path) const;
+	/**
+	 * @brief Gives the time of the last modification of a diagram.
+	 *
+	 * @param path the path of the diagram
+	 *
+	 * @return the modification time of the store if the diagram is in the
+	 * store, of the loose file otherwise
+	 */
+	QDateTime lastModified(const QString& path) const;
+
+private:
+	/**
+	 * @brief Opens the store configured in the settings.
+	 *
+	 * @return the store, which may be closed if there is none
+	 */
+	static DiagramStore* openConfigured();
+
+	/**
+	 * @brief A diagram in the store
+	 */
+	struct Entry
+	{
+		/**
+		 * @brief the path of the diagram, relative to the diagrams
+		 * directory
+		 */
+		QString path;
+		/**
+		 * @brief the offset of the text of the diagram in the store
+		 */
+		quint64 dotOffset = 0;
+		/**
+		 * @brief the size of the text of the diagram in the store
+		 */
+		quint32 dotSize = 0;
+		/**
+		 * @brief whether the text is compressed
+		 */
+		bool dotCompressed = false;
+		/**
+		 * @brief the offset of the layout of the diagram in the store
+		 */
+		quint64 layoutOffset = 0;
+		/**
+		 * @brief the size of the layout in the store, 0 if there is none
+		 */
+		quint32 layoutSize = 0;
+	};
+
+	/**
+	 * @brief Reads the header and the index of the store.
+	 *
+	 * @return true if, and only if, the store is valid
+	 */
+	bool open();
+	/**
+	 * @brief Releases the store file.
+	 */
+	void close();
+	/**
+	 * @brief Gives the path of a diagram relative to the diagrams
+	 * directory.
+	 *
+	 * @param path the path of the diagram, absolute or relative
+	 *
+	 * @return the relative path, or an empty string if @p path is outside
+	 * the diagrams directory
+	 */
+	QString relativePath(const QString& path) const;
+	/**
+	 * @brief Gives a part of the store.
+	 *
+	 * @param offset the offset of the part
+	 * @param size the size of the part
+	 *
+	 * @return the part, pointing directly into the store mapped in memory,
+	 * or an empty array if it is outside the store
+	 */
+	QByteArray bytes(quint64 offset, quint32 size) const;
+
+	/**
+	 * @brief the store file
+	 */
+	QFile _file;
+	/**
+	 * @brief the store content mapped in memory
+	 */
+	uchar* _mapped = nullptr;
+	/**
+	 * @brief the size of the mapped content, read once since QFile::size()
+	 * is not safe to call from several threads
+	 */
+	qint64 _size = 0;
+	/**
+	 * @brief the diagrams directory, cleaned, without a trailing slash
+	 */
+	QString _root;
+	/**
+	 * @brief the modification time of the store
+	 */
+	QDateTime _modified;
+	/**
+	 * @brief whether the layouts of the store match the current settings
+	 */
+	bool _layoutsValid = false;
+	/**
+	 * @brief the diagrams in the store
+	 */
+	QVector<Entry> _entries;
+	/**
+	 * @brief the index of the diagrams by relative path
+	 */
+	QHash<QString, int> _byPath;
+	/**
+	 * @brief the index of the diagrams by symbol
+	 */
+	QMultiHash<QString, int> _bySymbol;
+};
+
+#endif // DIAGRAMSTORE_H
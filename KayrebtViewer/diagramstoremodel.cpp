@@ -0,0 +1,108 @@
+/**
+ * @file diagramstoremodel.cpp
+ * @brief Implementation of class DiagramStoreModel
+ */
+#include <algorithm>
+#include <QStringList>
+#include "diagramstore.h"
+#include "diagramstoremodel.h"
+
+DiagramStoreModel::DiagramStoreModel(const DiagramStore& store, QObject* parent) :
+	QAbstractItemModel(parent),
+	_store(store)
+{
+	QVector<int> entries(store.getEntryCount());
+	for (int i = 0 ; i < entries.size() ; i++)
+		entries[i] = i;
+	std::sort(entries.begin(), entries.end(), [&store](int a, int b) {
+		return store.getPath(a) < store.getPath(b);
+	});
+
+	Item root;
+	root.parent = -1;
+	root.row = 0;
+	root.entry = -1;
+	_items.append(root);
+
+	// the paths being sorted, the content of a directory is contiguous,
+	// so a directory is always the last child of its parent while it is
+	// being filled
+	for (int entry : entries) {
+		QStringList components = store.getPath(entry).split('/', QString::SkipEmptyParts);
+		int current = 0;
+		for (int c = 0 ; c < components.size() ; c++) {
+			bool isFile = c == components.size() - 1;
+			const QVector<int>& children = _items[current].children;
+			if (!isFile && !children.isEmpty()) {
+				const Item& last = _items[children.last()];
+				if (last.entry < 0 && last.name == components[c]) {
+					current = children.last();
+					continue;
+				}
+			}
+
+			Item item;
+			item.name = components[c];
+			item.parent = current;
+			item.row = children.size();
+			item.entry = isFile ? entry : -1;
+			int index = _items.size();
+			_items.append(item);
+			_items[current].children.append(index);
+			current = index;
+		}
+	}
+}
+
+int DiagramStoreModel::item(const QModelIndex& index) const
+{
+	return index.isValid() ? int(index.internalId()) : 0;
+}
+
+QString DiagramStoreModel::filePath(const QModelIndex& index) const
+{
+	int entry = _items[item(index)].entry;
+	return entry < 0 ? QString() : _store.getPath(entry);
+}
+
+QModelIndex DiagramStoreModel::index(int row, int column, const QModelIndex& parent) const
+{
+	const QVector<int>& children = _items[item(parent)].children;
+	if (row < 0 || row >= children.size() || column != 0)
+		return QModelIndex();
+	return createIndex(row, column, quint32(children[row]));
+}
+
+QModelIndex DiagramStoreModel::parent(const QModelIndex& child) const
+{
+	int parent = _items[item(child)].parent;
+	if (parent <= 0)
+		return QModelIndex();
+	return createIndex(_items[parent].row, 0, quint32(parent));
+}
+
+int DiagramStoreModel::rowCount(const QModelIndex& parent) const
+{
+	if (parent.column() > 0)
+		return 0;
+	return _items[item(parent)].children.size();
+}
+
+int DiagramStoreModel::columnCount(const QModelIndex&) const
+{
+	return 1;
+}
+
+QVariant DiagramStoreModel::data(const QModelIndex& index, int role) const
+{
+	if (!index.isValid() || role != Qt::DisplayRole)
+		return QVariant();
+	return _items[item(index)].name;
+}
+
+QVariant DiagramStoreModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if (section == 0 && orientation == Qt::Horizontal && role == Qt::DisplayRole)
+		return tr("Name");
+	return QVariant();
+}
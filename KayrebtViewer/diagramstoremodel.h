@@ -0,0 +1,101 @@
+/**
+ * @file diagramstoremodel.h
+ * @brief Definition of class DiagramStoreModel
+ */
+#ifndef DIAGRAMSTOREMODEL_H
+#define DIAGRAMSTOREMODEL_H
+
+#include <QAbstractItemModel>
+#include <QString>
+#include <QVector>
+
+class DiagramStore;
+
+/**
+ * @brief This class presents the diagrams of a DiagramStore as a tree of
+ * directories and files, like a QFileSystemModel does for loose files.
+ *
+ * The tree is built once from the path index of the store, which is never
+ * modified, so the model is read-only and never changes.
+ */
+class DiagramStoreModel : public QAbstractItemModel
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * @brief Constructor.
+	 *
+	 * @param store the diagram store, which must outlive the model
+	 * @param parent the parent object
+	 */
+	explicit DiagramStoreModel(const DiagramStore& store, QObject* parent = nullptr);
+
+	/**
+	 * @brief Gives the path of the diagram at an index.
+	 *
+	 * @param index the index of interest
+	 *
+	 * @return the path of the diagram, relative to the diagrams directory,
+	 * or an empty string if @p index is a directory
+	 */
+	QString filePath(const QModelIndex& index) const;
+
+	QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+	QModelIndex parent(const QModelIndex& child) const override;
+	int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+	int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+	/**
+	 * @brief A directory or a diagram in the tree
+	 */
+	struct Item
+	{
+		/**
+		 * @brief the name of the directory or diagram file
+		 */
+		QString name;
+		/**
+		 * @brief the index of the parent directory, -1 for the root
+		 */
+		int parent;
+		/**
+		 * @brief the position of the item among its siblings
+		 */
+		int row;
+		/**
+		 * @brief the index of the diagram in the store, -1 for a
+		 * directory
+		 */
+		int entry;
+		/**
+		 * @brief the indices of the items in the directory, in the
+		 * order of their paths
+		 */
+		QVector<int> children;
+	};
+
+	/**
+	 * @brief Gives the item of the tree at an index.
+	 *
+	 * @param index the index of interest
+	 *
+	 * @return the index of the item in @a _items, 0 (the root) for an
+	 * invalid index
+	 */
+	int item(const QModelIndex& index) const;
+
+	/**
+	 * @brief the diagram store
+	 */
+	const DiagramStore& _store;
+	/**
+	 * @brief the items of the tree, the root being the first one
+	 */
+	QVector<Item> _items;
+};
+
+#endif // DIAGRAMSTOREMODEL_H
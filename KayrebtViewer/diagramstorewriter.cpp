@@ -0,0 +1,110 @@
+/**
+ * @file diagramstorewriter.cpp
+ * @brief Implementation of class DiagramStoreWriter
+ */
+#include <QCoreApplication>
+#include <QFileInfo>
+#include "diagramstore.h"
+#include "diagramstorewriter.h"
+
+DiagramStoreWriter::DiagramStoreWriter(const QString& filename) :
+	_filename(filename),
+	_file(QString("%1.%2.tmp").arg(filename).arg(QCoreApplication::applicationPid()))
+{
+	if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return;
+	_out.setDevice(&_file);
+	_out.setVersion(QDataStream::Qt_4_8);
+	// the offset of the index is only known at the end
+	_out << DiagramStore::MAGIC << DiagramStore::FORMAT_VERSION << quint64(0);
+}
+
+DiagramStoreWriter::~DiagramStoreWriter()
+{
+	if (!_committed && _file.isOpen()) {
+		_file.close();
+		_file.remove();
+	}
+}
+
+bool DiagramStoreWriter::isOk() const
+{
+	return _file.isOpen() && _out.status() == QDataStream::Ok && _file.error() == QFile::NoError;
+}
+
+QString DiagramStoreWriter::errorString() const
+{
+	return _file.errorString();
+}
+
+int DiagramStoreWriter::getEntryCount() const
+{
+	return _entries.size();
+}
+
+quint64 DiagramStoreWriter::write(const QByteArray& data)
+{
+	quint64 offset = _file.pos();
+	_out.writeRawData(data.constData(), data.size());
+	return offset;
+}
+
+bool DiagramStoreWriter::add(const QString& path, const QByteArray& dot, const GraphLayout* layout)
+{
+	if (!isOk())
+		return false;
+
+	Entry entry;
+	entry.path = path;
+	entry.symbol = QFileInfo(path).completeBaseName();
+
+	// small diagrams may not be worth compressing
+	QByteArray compressed = qCompress(dot);
+	entry.dotCompressed = compressed.size() < dot.size();
+	const QByteArray& text = entry.dotCompressed ? compressed : dot;
+	entry.dotOffset = write(text);
+	entry.dotSize = text.size();
+
+	entry.layoutOffset = 0;
+	entry.layoutSize = 0;
+	if (layout) {
+		QByteArray data;
+		QDataStream out(&data, QIODevice::WriteOnly);
+		out.setVersion(QDataStream::Qt_4_8);
+		out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+		out << *layout;
+		compressed = qCompress(data);
+		entry.layoutOffset = write(compressed);
+		entry.layoutSize = compressed.size();
+	}
+
+	if (!isOk())
+		return false;
+	_entries.append(entry);
+	return true;
+}
+
+bool DiagramStoreWriter::commit()
+{
+	if (!isOk())
+		return false;
+
+	quint64 indexOffset = _file.pos();
+	_out << DiagramStore::layoutSignature() << quint32(_entries.size());
+	for (const Entry& entry : _entries)
+		_out << entry.path << entry.symbol << entry.dotOffset << entry.dotSize << entry.dotCompressed
+			 << entry.layoutOffset << entry.layoutSize;
+
+	// the offset of the index follows the magic number and the version
+	_file.seek(sizeof(quint32) + sizeof(quint16));
+	_out << indexOffset;
+	_file.close();
+	if (_out.status() != QDataStream::Ok || _file.error() != QFile::NoError) {
+		_file.remove();
+		return false;
+	}
+
+	QFile::remove(_filename);
+	_committed = _file.rename(_filename);
+	return _committed;
+}
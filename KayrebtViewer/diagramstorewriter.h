@@ -0,0 +1,145 @@
+/**
+ * @file diagramstorewriter.h
+ * @brief Definition of class DiagramStoreWriter
+ */
+#ifndef DIAGRAMSTOREWRITER_H
+#define DIAGRAMSTOREWRITER_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include "graphlayout.h"
+
+/**
+ * @brief This class writes a packed diagram store, to be read by
+ * DiagramStore.
+ *
+ * The diagrams are appended to the store one by one, only the index is kept in
+ * memory. The store is written in a temporary file, which replaces the store
+ * file only when commit() succeeds, so that readers never see a partially
+ * written store.
+ */
+class DiagramStoreWriter
+{
+public:
+	/**
+	 * @brief Constructor. Starts writing a store.
+	 *
+	 * @param filename the store file
+	 */
+	explicit DiagramStoreWriter(const QString& filename);
+	/**
+	 * @brief Destroys the writer, discarding the store if it has not been
+	 * committed.
+	 */
+	~DiagramStoreWriter();
+
+	/**
+	 * @brief Tells whether the writer can still write the store.
+	 *
+	 * @return true if, and only if, no error happened so far
+	 */
+	bool isOk() const;
+	/**
+	 * @brief Gives the reason of the last error.
+	 *
+	 * @return a description of the error
+	 */
+	QString errorString() const;
+	/**
+	 * @brief Adds a diagram to the store.
+	 *
+	 * @param path the path of the diagram, relative to the diagrams
+	 * directory
+	 * @param dot the text of the diagram, in dot format
+	 * @param layout the layout of the diagram, or nullptr to store the
+	 * diagram without its layout
+	 *
+	 * @return true if, and only if, the diagram was written
+	 */
+	bool add(const QString& path, const QByteArray& dot, const GraphLayout* layout = nullptr);
+	/**
+	 * @brief Writes the index and puts the store in place.
+	 *
+	 * @return true if, and only if, the store was written
+	 */
+	bool commit();
+
+	/**
+	 * @brief Gives the number of diagrams added to the store.
+	 *
+	 * @return the number of entries
+	 */
+	int getEntryCount() const;
+
+private:
+	/**
+	 * @brief A diagram written in the store
+	 */
+	struct Entry
+	{
+		/**
+		 * @brief the path of the diagram, relative to the diagrams
+		 * directory
+		 */
+		QString path;
+		/**
+		 * @brief the name of the function the diagram represents
+		 */
+		QString symbol;
+		/**
+		 * @brief the offset of the text of the diagram
+		 */
+		quint64 dotOffset;
+		/**
+		 * @brief the size of the text of the diagram in the store
+		 */
+		quint32 dotSize;
+		/**
+		 * @brief whether the text is compressed
+		 */
+		bool dotCompressed;
+		/**
+		 * @brief the offset of the layout of the diagram
+		 */
+		quint64 layoutOffset;
+		/**
+		 * @brief the size of the layout, 0 if there is none
+		 */
+		quint32 layoutSize;
+	};
+
+	/**
+	 * @brief Appends raw data to the store.
+	 *
+	 * @param data the data
+	 *
+	 * @return the offset of the data in the store
+	 */
+	quint64 write(const QByteArray& data);
+
+	/**
+	 * @brief the store file
+	 */
+	QString _filename;
+	/**
+	 * @brief the temporary file being written
+	 */
+	QFile _file;
+	/**
+	 * @brief the stream writing the header and the index
+	 */
+	QDataStream _out;
+	/**
+	 * @brief the diagrams written so far
+	 */
+	QVector<Entry> _entries;
+	/**
+	 * @brief whether commit() was called successfully
+	 */
+	bool _committed = false;
+};
+
+#endif // DIAGRAMSTOREWRITER_H
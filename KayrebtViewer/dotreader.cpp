@@ -0,0 +1,607 @@
+/**
+ * @file dotreader.cpp
+ * @brief Implementation of class DotReader
+ */
+#include <cstring>
+#include <stdexcept>
+#include "dotreader.h"
+#include "graphlayout.h"
+
+DiagramData DotReader::read(const char* data, qint64 size)
+{
+	DotReader reader(data, size);
+	reader.parseGraph();
+	return reader._data;
+}
+
+DotReader::DotReader(const char* data, qint64 size) :
+	_cur(data),
+	_end(data + size)
+{
+	_nodeOfString.fill(0, _data._strings.size());
+	_data._dpi = GraphLayout::DEFAULT_DPI;
+}
+
+void DotReader::parseGraph()
+{
+	Token t = next();
+	if (isKeyword(t, "strict")) {
+		_strict = true;
+		t = next();
+	}
+	if (isKeyword(t, "graph"))
+		_directed = false;
+	else if (!isKeyword(t, "digraph"))
+		error(QString("'graph' or 'digraph' expected"));
+	if (peek().type == ID_TOKEN)
+		next(); // the name of the graph is of no use
+	expect(LBRACE_TOKEN, "'{'");
+
+	Scope scope;
+	QVector<int> members;
+	parseStatements(scope, members);
+	if (peek().type != END_TOKEN)
+		error(QString("end of file expected after the graph"));
+
+	groupEdgesByTail();
+}
+
+void DotReader::parseStatements(Scope& scope, QVector<int>& members)
+{
+	for (;;) {
+		const Token& first = peek();
+		if (first.type == RBRACE_TOKEN) {
+			next();
+			return;
+		}
+		if (first.type == END_TOKEN)
+			error(QString("'}' expected before the end of file"));
+		if (first.type == SEMICOLON_TOKEN) {
+			next();
+			continue;
+		}
+
+		if (isKeyword(first, "graph") || isKeyword(first, "node") || isKeyword(first, "edge")) {
+			Token kind = next();
+			Attributes attrs;
+			parseAttributes(attrs);
+			if (isKeyword(kind, "graph")) {
+				if (scope.root)
+					for (const QPair<Token,Token>& attr : attrs)
+						setGraphAttribute(attr.first, attr.second);
+			} else {
+				setDefaultAttributes(kind, scope, attrs);
+			}
+			continue;
+		}
+
+		// "ID = ID" is a graph attribute, anything else starting with
+		// an ID is a node or an edge statement
+		if (first.type == ID_TOKEN && !isKeyword(first, "subgraph")) {
+			Token name = next();
+			if (peek().type == EQUAL_TOKEN) {
+				next();
+				Token value = expect(ID_TOKEN, "attribute value");
+				if (scope.root)
+					setGraphAttribute(name, value);
+				continue;
+			}
+			int n = node(name, scope);
+			members.append(n);
+			if (peek().type == COLON_TOKEN) { // port, ignored
+				next();
+				expect(ID_TOKEN, "port");
+				if (peek().type == COLON_TOKEN) {
+					next();
+					expect(ID_TOKEN, "compass point");
+				}
+			}
+			if (peek().type != EDGEOP_TOKEN) {
+				Attributes attrs;
+				parseAttributes(attrs);
+				setNodeAttributes(n, attrs);
+				continue;
+			}
+			// an edge statement, go on below with the first operand
+			QVector<int> tails(1, n);
+			QVector<int> created;
+			while (peek().type == EDGEOP_TOKEN) {
+				next();
+				QVector<int> heads;
+				parseOperand(scope, heads);
+				members += heads;
+				for (int tail : tails)
+					for (int head : heads)
+						created.append(edge(tail, head, scope));
+				tails = heads;
+			}
+			Attributes attrs;
+			parseAttributes(attrs);
+			for (int e : created)
+				setEdgeAttributes(e, attrs);
+			continue;
+		}
+
+		// a subgraph, alone or starting an edge statement
+		QVector<int> tails;
+		parseOperand(scope, tails);
+		members += tails;
+		QVector<int> created;
+		while (peek().type == EDGEOP_TOKEN) {
+			next();
+			QVector<int> heads;
+			parseOperand(scope, heads);
+			members += heads;
+			for (int tail : tails)
+				for (int head : heads)
+					created.append(edge(tail, head, scope));
+			tails = heads;
+		}
+		if (!created.isEmpty()) {
+			Attributes attrs;
+			parseAttributes(attrs);
+			for (int e : created)
+				setEdgeAttributes(e, attrs);
+		}
+	}
+}
+
+void DotReader::parseOperand(Scope& scope, QVector<int>& operand)
+{
+	Token t = next();
+	if (t.type == LBRACE_TOKEN) {
+		parseSubgraph(scope, operand);
+	} else if (isKeyword(t, "subgraph")) {
+		if (peek().type == ID_TOKEN)
+			next(); // subgraphs are only used for grouping nodes
+		expect(LBRACE_TOKEN, "'{'");
+		parseSubgraph(scope, operand);
+	} else if (t.type == ID_TOKEN) {
+		operand.append(node(t, scope));
+		if (peek().type == COLON_TOKEN) { // port, ignored
+			next();
+			expect(ID_TOKEN, "port");
+			if (peek().type == COLON_TOKEN) {
+				next();
+				expect(ID_TOKEN, "compass point");
+			}
+		}
+	} else {
+		error(QString("node or subgraph expected"));
+	}
+}
+
+void DotReader::parseSubgraph(const Scope& scope, QVector<int>& members)
+{
+	Scope inner = scope;
+	inner.root = false;
+	QVector<int> found;
+	parseStatements(inner, found);
+
+	// the subgraph is a set of nodes, as in cgraph, "a -> {b b}" is a
+	// single edge
+	int mark = ++_subgraphCount;
+	_subgraphMarks.resize(_data._nodeNames.size());
+	for (int n : found) {
+		if (_subgraphMarks[n] != mark) {
+			_subgraphMarks[n] = mark;
+			members.append(n);
+		}
+	}
+}
+
+void DotReader::parseAttributes(Attributes& attrs)
+{
+	while (peek().type == LBRACKET_TOKEN) {
+		next();
+		for (;;) {
+			Token name = next();
+			if (name.type == RBRACKET_TOKEN)
+				break;
+			if (name.type == COMMA_TOKEN || name.type == SEMICOLON_TOKEN)
+				continue;
+			if (name.type != ID_TOKEN)
+				error(QString("attribute name expected"));
+			expect(EQUAL_TOKEN, "'='");
+			Token value = expect(ID_TOKEN, "attribute value");
+			attrs.append(qMakePair(name, value));
+		}
+	}
+}
+
+int DotReader::node(const Token& name, const Scope& scope)
+{
+	int id = _data._strings.intern(name.begin, name.length);
+	if (id >= _nodeOfString.size())
+		_nodeOfString.resize(_data._strings.size());
+	if (_nodeOfString[id] != 0)
+		return _nodeOfString[id] - 1;
+
+	int n = _data._nodeNames.size();
+	_data._nodeNames.append(id);
+	_data._nodeUrls.append(scope.nodeUrl);
+	_data._nodeFiles.append(scope.nodeFile);
+	_data._nodeLines.append(scope.nodeLine);
+	_data._nodeLabels.append(scope.nodeLabel);
+	_data._nodeShapes.append(scope.nodeShape);
+	_data._nodeStyles.append(scope.nodeStyle);
+	_nodeOfString[id] = n + 1;
+	return n;
+}
+
+int DotReader::edge(int tail, int head, const Scope& scope)
+{
+	if (_strict) {
+		// in an undirected graph, a -- b and b -- a are the same edge
+		int first = _directed ? tail : qMin(tail, head);
+		int second = _directed ? head : qMax(tail, head);
+		quint64 ends = (quint64(quint32(first)) << 32) | quint32(second);
+		QHash<quint64, int>::const_iterator it = _strictEdges.constFind(ends);
+		if (it != _strictEdges.constEnd())
+			return it.value();
+		_strictEdges.insert(ends, _data._edgeTails.size());
+	}
+
+	int e = _data._edgeTails.size();
+	_data._edgeTails.append(tail);
+	_data._edgeHeads.append(head);
+	_data._edgeLabels.append(scope.edgeLabel);
+	_data._edgeStyles.append(scope.edgeStyle);
+	return e;
+}
+
+void DotReader::setNodeAttributes(int node, const Attributes& attrs)
+{
+	for (const QPair<Token,Token>& attr : attrs) {
+		const Token& value = attr.second;
+		if (is(attr.first, "URL"))
+			_data._nodeUrls[node] = _data._strings.intern(value.begin, value.length);
+		else if (is(attr.first, "filename"))
+			_data._nodeFiles[node] = _data._strings.intern(value.begin, value.length);
+		else if (is(attr.first, "line"))
+			_data._nodeLines[node] = bytes(value).toInt();
+		else if (is(attr.first, "label"))
+			_data._nodeLabels[node] = _data._strings.intern(value.begin, value.length);
+		else if (is(attr.first, "shape"))
+			_data._nodeShapes[node] = _data._strings.intern(value.begin, value.length);
+		else if (is(attr.first, "style"))
+			_data._nodeStyles[node] = _data._strings.intern(value.begin, value.length);
+	}
+}
+
+void DotReader::setEdgeAttributes(int edge, const Attributes& attrs)
+{
+	for (const QPair<Token,Token>& attr : attrs) {
+		const Token& value = attr.second;
+		if (is(attr.first, "label"))
+			_data._edgeLabels[edge] = _data._strings.intern(value.begin, value.length);
+		else if (is(attr.first, "style"))
+			_data._edgeStyles[edge] = _data._strings.intern(value.begin, value.length);
+	}
+}
+
+void DotReader::setGraphAttribute(const Token& name, const Token& value)
+{
+	if (is(name, "dpi")) {
+		bool ok;
+		qreal dpi = bytes(value).toDouble(&ok);
+		if (ok && dpi > 0)
+			_data._dpi = dpi;
+	} else if (is(name, "file")) {
+		_data._sourceFile = _data._strings.intern(value.begin, value.length);
+	} else if (is(name, "line")) {
+		_data._sourceLine = bytes(value).toInt();
+	}
+}
+
+void DotReader::setDefaultAttributes(const Token& kind, Scope& scope, const Attributes& attrs)
+{
+	for (const QPair<Token,Token>& attr : attrs) {
+		const Token& value = attr.second;
+		if (isKeyword(kind, "node")) {
+			if (is(attr.first, "URL"))
+				scope.nodeUrl = _data._strings.intern(value.begin, value.length);
+			else if (is(attr.first, "filename"))
+				scope.nodeFile = _data._strings.intern(value.begin, value.length);
+			else if (is(attr.first, "line"))
+				scope.nodeLine = bytes(value).toInt();
+			else if (is(attr.first, "label"))
+				scope.nodeLabel = _data._strings.intern(value.begin, value.length);
+			else if (is(attr.first, "shape"))
+				scope.nodeShape = _data._strings.intern(value.begin, value.length);
+			else if (is(attr.first, "style"))
+				scope.nodeStyle = _data._strings.intern(value.begin, value.length);
+		} else if (is(attr.first, "label")) {
+			scope.edgeLabel = _data._strings.intern(value.begin, value.length);
+		} else if (is(attr.first, "style")) {
+			scope.edgeStyle = _data._strings.intern(value.begin, value.length);
+		}
+	}
+}
+
+void DotReader::groupEdgesByTail()
+{
+	int nodes = _data._nodeNames.size();
+	int edges = _data._edgeTails.size();
+
+	// counting sort, stable so that the out-edges of a node stay in the
+	// order of their creation, as in GraphViz
+	QVector<int>& begin = _data._outEdgesBegin;
+	begin.fill(0, nodes + 1);
+	for (int e = 0 ; e < edges ; e++)
+		begin[_data._edgeTails[e] + 1]++;
+	for (int n = 0 ; n < nodes ; n++)
+		begin[n + 1] += begin[n];
+
+	QVector<int> position = begin;
+	QVector<int> tails(edges), heads(edges), labels(edges), styles(edges);
+	for (int e = 0 ; e < edges ; e++) {
+		int sorted = position[_data._edgeTails[e]]++;
+		tails[sorted] = _data._edgeTails[e];
+		heads[sorted] = _data._edgeHeads[e];
+		labels[sorted] = _data._edgeLabels[e];
+		styles[sorted] = _data._edgeStyles[e];
+	}
+	_data._edgeTails.swap(tails);
+	_data._edgeHeads.swap(heads);
+	_data._edgeLabels.swap(labels);
+	_data._edgeStyles.swap(styles);
+
+	// the in-edges are grouped by head the same way, in the order of
+	// their index
+	QVector<int>& inBegin = _data._inEdgesBegin;
+	inBegin.fill(0, nodes + 1);
+	for (int e = 0 ; e < edges ; e++)
+		inBegin[_data._edgeHeads[e] + 1]++;
+	for (int n = 0 ; n < nodes ; n++)
+		inBegin[n + 1] += inBegin[n];
+
+	position = inBegin;
+	_data._inEdges.resize(edges);
+	for (int e = 0 ; e < edges ; e++)
+		_data._inEdges[position[_data._edgeHeads[e]]++] = e;
+}
+
+DotReader::Token DotReader::next()
+{
+	if (_hasLookahead) {
+		_hasLookahead = false;
+		return _lookahead;
+	}
+
+	Token t;
+	skipBlanks();
+	if (_cur >= _end)
+		return t;
+
+	char c = *_cur;
+	switch (c) {
+		case '{': t.type = LBRACE_TOKEN; _cur++; return t;
+		case '}': t.type = RBRACE_TOKEN; _cur++; return t;
+		case '[': t.type = LBRACKET_TOKEN; _cur++; return t;
+		case ']': t.type = RBRACKET_TOKEN; _cur++; return t;
+		case '=': t.type = EQUAL_TOKEN; _cur++; return t;
+		case ';': t.type = SEMICOLON_TOKEN; _cur++; return t;
+		case ',': t.type = COMMA_TOKEN; _cur++; return t;
+		case ':': t.type = COLON_TOKEN; _cur++; return t;
+		case '"':
+			_cur++;
+			readQuoted(t);
+			return t;
+		case '<':
+			_cur++;
+			readHtml(t);
+			return t;
+		default:
+			break;
+	}
+
+	if (c == '-' && _cur + 1 < _end && (_cur[1] == '>' || _cur[1] == '-')) {
+		t.type = EDGEOP_TOKEN;
+		_cur += 2;
+		return t;
+	}
+
+	t.type = ID_TOKEN;
+	t.begin = _cur;
+	unsigned char u = c;
+	if (u == '_' || u >= 0x80 || (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z')) {
+		while (_cur < _end) {
+			u = *_cur;
+			if (u == '_' || u >= 0x80 || (u >= 'a' && u <= 'z') ||
+			    (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9'))
+				_cur++;
+			else
+				break;
+		}
+	} else if (c == '-' || c == '.' || (c >= '0' && c <= '9')) {
+		if (c == '-')
+			_cur++;
+		bool dot = false;
+		while (_cur < _end && ((*_cur >= '0' && *_cur <= '9') || (*_cur == '.' && !dot))) {
+			if (*_cur == '.')
+				dot = true;
+			_cur++;
+		}
+	} else {
+		error(QString("unexpected character '%1'").arg(QChar(c)));
+	}
+	t.length = _cur - t.begin;
+	return t;
+}
+
+const DotReader::Token& DotReader::peek()
+{
+	if (!_hasLookahead) {
+		_lookahead = next();
+		_hasLookahead = true;
+	}
+	return _lookahead;
+}
+
+DotReader::Token DotReader::expect(TokenType type, const char* what)
+{
+	Token t = next();
+	if (t.type != type)
+		error(QString("%1 expected").arg(what));
+	return t;
+}
+
+void DotReader::skipBlanks()
+{
+	while (_cur < _end) {
+		char c = *_cur;
+		if (c == '\n') {
+			_line++;
+			_cur++;
+			// lines starting with '#' are output by the C preprocessor
+			if (_cur < _end && *_cur == '#')
+				while (_cur < _end && *_cur != '\n')
+					_cur++;
+		} else if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v') {
+			_cur++;
+		} else if (c == '/' && _cur + 1 < _end && _cur[1] == '/') {
+			while (_cur < _end && *_cur != '\n')
+				_cur++;
+		} else if (c == '/' && _cur + 1 < _end && _cur[1] == '*') {
+			_cur += 2;
+			while (_cur + 1 < _end && !(_cur[0] == '*' && _cur[1] == '/')) {
+				if (*_cur == '\n')
+					_line++;
+				_cur++;
+			}
+			if (_cur + 1 >= _end)
+				error(QString("unterminated comment"));
+			_cur += 2;
+		} else {
+			break;
+		}
+	}
+}
+
+void DotReader::readQuoted(Token& token)
+{
+	token.type = ID_TOKEN;
+	token.quoted = true;
+
+	bool copied = false;
+	for (;;) {
+		const char* begin = _cur;
+		bool escaped = false;
+		while (_cur < _end && *_cur != '"') {
+			if (*_cur == '\\' && _cur + 1 < _end && _cur[1] == '\\') {
+				// \\ is kept as it is, as cgraph does, but it cannot
+				// escape what follows
+				_cur += 2;
+				continue;
+			}
+			if (*_cur == '\\' && _cur + 1 < _end && (_cur[1] == '"' || _cur[1] == '\n')) {
+				escaped = true;
+				_cur++;
+			}
+			if (*_cur == '\n')
+				_line++;
+			_cur++;
+		}
+		if (_cur >= _end)
+			error(QString("unterminated string"));
+
+		if (!escaped && !copied) {
+			token.begin = begin;
+			token.length = _cur - begin;
+		} else {
+			if (!copied) {
+				token.storage = QByteArray(token.begin, token.length);
+				copied = true;
+			}
+			// \" stands for ", \<newline> is a line continuation, \\ is
+			// kept
+			for (const char* p = begin ; p < _cur ; p++) {
+				if (*p == '\\' && p + 1 < _cur && p[1] == '\\') {
+					token.storage.append(p, 2);
+					p++;
+				} else if (*p == '\\' && p + 1 < _cur && p[1] == '"') {
+					token.storage.append('"');
+					p++;
+				} else if (*p == '\\' && p + 1 < _cur && p[1] == '\n') {
+					p++;
+				} else {
+					token.storage.append(*p);
+				}
+			}
+		}
+		_cur++; // closing quote
+
+		// "a" + "b" is the concatenation of the two strings
+		const char* save = _cur;
+		int line = _line;
+		skipBlanks();
+		if (_cur < _end && *_cur == '+') {
+			_cur++;
+			skipBlanks();
+			if (_cur < _end && *_cur == '"') {
+				_cur++;
+				if (!copied) {
+					token.storage = QByteArray(token.begin, token.length);
+					copied = true;
+				}
+				continue;
+			}
+			error(QString("string expected after '+'"));
+		}
+		_cur = save;
+		_line = line;
+		break;
+	}
+
+	if (copied) {
+		token.begin = token.storage.constData();
+		token.length = token.storage.size();
+	}
+}
+
+void DotReader::readHtml(Token& token)
+{
+	token.type = ID_TOKEN;
+	token.quoted = true;
+	token.begin = _cur;
+	int depth = 1;
+	while (_cur < _end) {
+		if (*_cur == '<') {
+			depth++;
+		} else if (*_cur == '>') {
+			if (--depth == 0)
+				break;
+		} else if (*_cur == '\n') {
+			_line++;
+		}
+		_cur++;
+	}
+	if (_cur >= _end)
+		error(QString("unterminated HTML string"));
+	token.length = _cur - token.begin;
+	_cur++; // closing bracket
+}
+
+void DotReader::error(const QString& message) const
+{
+	throw std::runtime_error(QString("line %1: %2").arg(_line).arg(message).toStdString());
+}
+
+bool DotReader::isKeyword(const Token& t, const char* keyword)
+{
+	return t.type == ID_TOKEN && !t.quoted &&
+		t.length == int(std::strlen(keyword)) &&
+		qstrnicmp(t.begin, keyword, t.length) == 0;
+}
+
+bool DotReader::is(const Token& t, const char* name)
+{
+	return t.length == int(std::strlen(name)) &&
+		std::memcmp(t.begin, name, t.length) == 0;
+}
+
+QByteArray DotReader::bytes(const Token& t)
+{
+	return QByteArray::fromRawData(t.begin, t.length);
+}
@@ -0,0 +1,360 @@
+/**
+ * @file dotreader.h
+ * @brief Definition of class DotReader
+ */
+#ifndef DOTREADER_H
+#define DOTREADER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include "diagramdata.h"
+
+/**
+ * @brief This class reads a diagram in dot format into a DiagramData.
+ *
+ * The reader works in a single pass over the text, without building any
+ * intermediate tree, and only keeps the attributes used by the viewer. It
+ * understands the part of the dot language emitted by Kayrebt::Extractor and
+ * a bit more: graph, node and edge statements, attribute statements,
+ * anonymous and named subgraphs, edge chains, ports (which are ignored),
+ * quoted strings with concatenations, HTML strings and comments.
+ *
+ * It is much faster than GraphViz's parser and uses much less memory, the
+ * text can directly be read from a file mapped in memory.
+ */
+class DotReader
+{
+public:
+	/**
+	 * @brief Reads a diagram.
+	 *
+	 * \throw std::runtime_error if the text is not a valid diagram
+	 *
+	 * @param data the text of the diagram, in dot format, not necessarily
+	 * terminated by a null character
+	 * @param size the number of bytes in @p data
+	 *
+	 * @return the structure and attributes of the diagram
+	 */
+	static DiagramData read(const char* data, qint64 size);
+
+private:
+	/**
+	 * @brief The kinds of tokens of the dot language
+	 */
+	enum TokenType {
+		END_TOKEN,
+		ID_TOKEN,
+		LBRACE_TOKEN,
+		RBRACE_TOKEN,
+		LBRACKET_TOKEN,
+		RBRACKET_TOKEN,
+		EQUAL_TOKEN,
+		SEMICOLON_TOKEN,
+		COMMA_TOKEN,
+		COLON_TOKEN,
+		EDGEOP_TOKEN
+	};
+
+	/**
+	 * @brief A token of the dot language
+	 */
+	struct Token
+	{
+		/**
+		 * @brief the kind of token
+		 */
+		TokenType type = END_TOKEN;
+		/**
+		 * @brief the first character of the token value
+		 */
+		const char* begin = nullptr;
+		/**
+		 * @brief the length of the token value
+		 */
+		int length = 0;
+		/**
+		 * @brief whether the token is a quoted or HTML string, which
+		 * cannot be a keyword
+		 */
+		bool quoted = false;
+		/**
+		 * @brief the storage of the token value when it is not a
+		 * plain substring of the text (strings with escaped characters
+		 * or concatenations)
+		 */
+		QByteArray storage;
+	};
+
+	/**
+	 * @brief The default attributes in a graph or subgraph
+	 */
+	struct Scope
+	{
+		/**
+		 * @brief whether this is the root graph rather than a subgraph
+		 */
+		bool root = true;
+		/**
+		 * @brief the default node attribute "URL"
+		 */
+		int nodeUrl = 0;
+		/**
+		 * @brief the default node attribute "filename"
+		 */
+		int nodeFile = 0;
+		/**
+		 * @brief the default node attribute "line"
+		 */
+		int nodeLine = 0;
+		/**
+		 * @brief the default node attribute "label"
+		 */
+		int nodeLabel = 0;
+		/**
+		 * @brief the default node attribute "shape"
+		 */
+		int nodeShape = 0;
+		/**
+		 * @brief the default node attribute "style"
+		 */
+		int nodeStyle = 0;
+		/**
+		 * @brief the default edge attribute "label"
+		 */
+		int edgeLabel = 0;
+		/**
+		 * @brief the default edge attribute "style"
+		 */
+		int edgeStyle = 0;
+	};
+
+	/**
+	 * @brief a list of attributes, as pairs of names and values
+	 */
+	typedef QVector<QPair<Token,Token>> Attributes;
+
+	/**
+	 * @brief Constructor.
+	 *
+	 * @param data the text of the diagram
+	 * @param size the number of bytes in @p data
+	 */
+	DotReader(const char* data, qint64 size);
+
+	/**
+	 * @brief Reads the whole diagram.
+	 */
+	void parseGraph();
+	/**
+	 * @brief Reads statements until the closing brace of the current
+	 * graph or subgraph.
+	 *
+	 * @param scope the default attributes of the graph or subgraph
+	 * @param members receives the nodes appearing in the graph or subgraph
+	 */
+	void parseStatements(Scope& scope, QVector<int>& members);
+	/**
+	 * @brief Reads one node, edge or subgraph operand.
+	 *
+	 * @param scope the default attributes of the enclosing graph
+	 * @param operand receives the nodes designated by the operand
+	 */
+	void parseOperand(Scope& scope, QVector<int>& operand);
+	/**
+	 * @brief Reads a subgraph, the keyword "subgraph" and its name, if
+	 * any, having already been read.
+	 *
+	 * @param scope the default attributes of the enclosing graph
+	 * @param members receives the nodes appearing in the subgraph, once
+	 * each
+	 */
+	void parseSubgraph(const Scope& scope, QVector<int>& members);
+	/**
+	 * @brief Reads the attribute lists following a statement, if any.
+	 *
+	 * @param attrs receives the attributes
+	 */
+	void parseAttributes(Attributes& attrs);
+
+	/**
+	 * @brief Gets the index of a node, creating it if necessary.
+	 *
+	 * @param name the identifier of the node
+	 * @param scope the default attributes to give to a new node
+	 *
+	 * @return the index of the node
+	 */
+	int node(const Token& name, const Scope& scope);
+	/**
+	 * @brief Creates an edge, or finds it in a strict graph.
+	 *
+	 * @param tail the index of the tail node
+	 * @param head the index of the head node
+	 * @param scope the default attributes to give to a new edge
+	 *
+	 * @return the index of the edge, in creation order
+	 */
+	int edge(int tail, int head, const Scope& scope);
+	/**
+	 * @brief Applies attributes to a node.
+	 */
+	void setNodeAttributes(int node, const Attributes& attrs);
+	/**
+	 * @brief Applies attributes to an edge.
+	 */
+	void setEdgeAttributes(int edge, const Attributes& attrs);
+	/**
+	 * @brief Applies attributes to the root graph.
+	 */
+	void setGraphAttribute(const Token& name, const Token& value);
+	/**
+	 * @brief Applies attributes to the default node or edge attributes of
+	 * a scope.
+	 *
+	 * @param kind "node" or "edge"
+	 */
+	void setDefaultAttributes(const Token& kind, Scope& scope, const Attributes& attrs);
+	/**
+	 * @brief Sorts the edges by tail node and computes the index of the
+	 * first out-edge of each node, then lists the in-edges of each node.
+	 */
+	void groupEdgesByTail();
+
+	/**
+	 * @brief Reads the next token.
+	 *
+	 * @return the token
+	 */
+	Token next();
+	/**
+	 * @brief Gives the next token without consuming it.
+	 *
+	 * @return the token
+	 */
+	const Token& peek();
+	/**
+	 * @brief Reads the next token and checks its type.
+	 *
+	 * \throw std::runtime_error if the token is not of type @p type
+	 *
+	 * @param type the type expected
+	 * @param what a description of what is expected, for error messages
+	 *
+	 * @return the token
+	 */
+	Token expect(TokenType type, const char* what);
+	/**
+	 * @brief Skips white spaces and comments.
+	 */
+	void skipBlanks();
+	/**
+	 * @brief Reads a quoted string, the opening quote having been read.
+	 *
+	 * @param token receives the string
+	 */
+	void readQuoted(Token& token);
+	/**
+	 * @brief Reads an HTML string, the opening bracket having been read.
+	 *
+	 * @param token receives the string
+	 */
+	void readHtml(Token& token);
+	/**
+	 * @brief Throws an exception describing a syntax error.
+	 *
+	 * @param message the description of the error
+	 */
+	[[noreturn]] void error(const QString& message) const;
+
+	/**
+	 * @brief Tells whether a token is a given keyword.
+	 *
+	 * @param t the token
+	 * @param keyword the keyword, in lower case
+	 *
+	 * @return true if, and only if, @p t is an unquoted identifier
+	 * matching @p keyword without regard to case
+	 */
+	static bool isKeyword(const Token& t, const char* keyword);
+	/**
+	 * @brief Tells whether a token is a given attribute name.
+	 *
+	 * @param t the token
+	 * @param name the attribute name
+	 *
+	 * @return true if, and only if, the value of @p t is @p name
+	 */
+	static bool is(const Token& t, const char* name);
+	/**
+	 * @brief Gives the value of a token as a byte array, without copying
+	 * it.
+	 *
+	 * The result is only valid as long as the token is.
+	 *
+	 * @param t the token
+	 *
+	 * @return the value of the token
+	 */
+	static QByteArray bytes(const Token& t);
+
+	/**
+	 * @brief the current position in the text
+	 */
+	const char* _cur;
+	/**
+	 * @brief the end of the text
+	 */
+	const char* _end;
+	/**
+	 * @brief the current line, for error messages
+	 */
+	int _line = 1;
+	/**
+	 * @brief the token read in advance by peek()
+	 */
+	Token _lookahead;
+	/**
+	 * @brief whether @a _lookahead holds a token
+	 */
+	bool _hasLookahead = false;
+	/**
+	 * @brief whether the graph is strict, i.e. whether it merges the
+	 * edges having the same ends
+	 */
+	bool _strict = false;
+	/**
+	 * @brief whether the graph is directed, i.e. whether the ends of its
+	 * edges are ordered
+	 */
+	bool _directed = true;
+
+	/**
+	 * @brief the diagram being read
+	 */
+	DiagramData _data;
+	/**
+	 * @brief the index plus one of the node named after each string of the
+	 * pool, 0 if there is none
+	 */
+	QVector<int> _nodeOfString;
+	/**
+	 * @brief the edges created so far in a strict graph, indexed by their
+	 * ends
+	 */
+	QHash<quint64, int> _strictEdges;
+	/**
+	 * @brief for each node, the last subgraph in which it has been
+	 * collected, see parseSubgraph()
+	 */
+	QVector<int> _subgraphMarks;
+	/**
+	 * @brief the number of subgraphs read so far
+	 */
+	int _subgraphCount = 0;
+};
+
+#endif // DOTREADER_H
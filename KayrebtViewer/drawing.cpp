@@ -10,11 +10,17 @@
 #include <QWheelEvent>
 #include <QInputEvent>
 #include <QEvent>
+#include <QElapsedTimer>
 #include <QMenu>
+#include <QPainter>
+#include <QSettings>
 #include <QTimer>
 #include <QtCore>
 #include "graph.h"
 #include "drawing.h"
+#include "minimap.h"
+#include "progressscene.h"
+#include "tilecache.h"
 
 Drawing::Drawing(quint64 id, QString inputFileName, QWidget *parent) :
 	QGraphicsView(parent)
@@ -23,12 +29,26 @@ Drawing::Drawing(quint64 id, QString inputFileName, QWidget *parent) :
 	setContextMenuPolicy(Qt::CustomContextMenu);
 	connect(this, SIGNAL(customContextMenuRequested(const QPoint&)), this, SLOT(showContextMenu(const QPoint&)));
 
-	QGraphicsScene* temporaryScene = new QGraphicsScene();
-	temporaryScene->addText("Graph in construction, a moment please...\n (remember I can draw only one graph at a time (wait until next release ;) )");
-	temporaryScene->setBackgroundBrush(QBrush(Qt::gray));
-	setScene(temporaryScene);
+	_placeholder = new ProgressScene(_graph, this);
+	setScene(_placeholder);
 
+	connect(_graph, SIGNAL(aboutToBuild()), this, SLOT(chooseInitialView()));
 	connect(_graph, SIGNAL(graphBuilt()), this, SLOT(setGraphReady()));
+	connect(_graph, SIGNAL(layoutAboutToChange()), this, SLOT(rememberAnchor()));
+	connect(_graph, SIGNAL(layoutChanged()), this, SLOT(restoreAnchor()));
+
+	_idleTimer.setSingleShot(true);
+	_idleTimer.setInterval(INTERACTION_IDLE);
+	connect(&_idleTimer, SIGNAL(timeout()), this, SLOT(endInteraction()));
+	_frameBudget = QSettings().value("frame budget", DEFAULT_FRAME_BUDGET).toReal();
+
+	int tileMemory = QSettings().value("tile cache", 0).toInt();
+	if (tileMemory > 0) {
+		_tiles = new TileCache(_graph, tileMemory * 1024 * 1024, this);
+		connect(_tiles, SIGNAL(tilesChanged()), viewport(), SLOT(update()));
+		connect(_graph, SIGNAL(elementsChanged(QVector<QRectF>)), _tiles, SLOT(invalidate(QVector<QRectF>)));
+		connect(_graph, SIGNAL(layoutChanged()), _tiles, SLOT(clear()));
+	}
 	_graph->build();
 }
 
@@ -40,11 +60,13 @@ void Drawing::wheelEvent(QWheelEvent *event)
 		setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
 	}
 
+	beginInteraction();
 	const qreal scaleFactor = 1.2;
 	if (event->delta() > 0)
 		this->scale(scaleFactor, scaleFactor);
 	else
 		this->scale(1.0/scaleFactor, 1.0/scaleFactor);
+	updateView();
 }
 
 Drawing::~Drawing()
@@ -55,29 +77,182 @@ Drawing::~Drawing()
 void Drawing::zoomToFit()
 {
 	fitInView(scene()->sceneRect(), Qt::KeepAspectRatio);
+	updateView();
+}
+
+void Drawing::chooseInitialView()
+{
+	QRectF scene = _graph->sceneRect();
+	QSize size = viewport()->size();
+	if (scene.isEmpty() || size.isEmpty())
+		return;
+
+	qreal fit = qMin(size.width() / scene.width(), size.height() / scene.height());
+	if (fit >= MIN_INITIAL_SCALE) {
+		_initialView = scene;
+	} else {
+		// the whole diagram would be unreadable, show its beginning,
+		// at the top
+		QSizeF shown(size.width() / MIN_INITIAL_SCALE, size.height() / MIN_INITIAL_SCALE);
+		_initialView = QRectF(QPointF(scene.center().x() - shown.width() / 2, scene.top()), shown);
+	}
+	_graph->setInitialView(_initialView);
 }
 
 void Drawing::setGraphReady()
 {
 	_graphReady = true;
-	QGraphicsScene* oldScene = scene();
 	setScene(_graph);
-	oldScene->deleteLater();
+	_placeholder->deleteLater();
+	_placeholder = nullptr;
 
 	setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
 	setDragMode(QGraphicsView::ScrollHandDrag);
 	invalidateScene();
 	disconnect(_graph, SIGNAL(graphBuilt()), this, SLOT(setGraphReady()));
+
+	if (QSettings().value("minimap", true).toBool()) {
+		_minimap = new Minimap(_graph, this);
+		_minimap->hide();
+		connect(_minimap, SIGNAL(centerRequested(QPointF)), this, SLOT(showPoint(QPointF)));
+		connect(_graph, SIGNAL(elementsChanged(QVector<QRectF>)), _minimap, SLOT(patch(QVector<QRectF>)));
+		connect(_graph, SIGNAL(layoutChanged()), _minimap, SLOT(refresh()));
+	}
+	updateView();
+}
+
+void Drawing::rememberAnchor()
+{
+	_anchor = -1;
+	if (!_graphReady || !_alreadyShown)
+		return; // the view will fit the diagram anyway
+
+	QPointF center = mapToScene(viewport()->rect().center());
+	_anchor = _graph->nearestNode(center);
+	if (_anchor >= 0)
+		_anchorOffset = center - _graph->getNodeCenter(_anchor);
+}
+
+void Drawing::restoreAnchor()
+{
+	if (_anchor >= 0)
+		centerOn(_graph->getNodeCenter(_anchor) + _anchorOffset);
+	_anchor = -1;
+	// the minimap may have a new size
+	updateView();
+}
+
+void Drawing::showPoint(const QPointF& point)
+{
+	centerOn(point);
+}
+
+void Drawing::placeMinimap()
+{
+	if (!_minimap)
+		return;
+	QRect area = viewport()->geometry();
+	_minimap->move(area.right() - _minimap->width() - MINIMAP_MARGIN,
+				   area.bottom() - _minimap->height() - MINIMAP_MARGIN);
+}
+
+void Drawing::resizeEvent(QResizeEvent *event)
+{
+	QGraphicsView::resizeEvent(event);
+	updateView();
+}
+
+void Drawing::scrollContentsBy(int dx, int dy)
+{
+	beginInteraction();
+	QGraphicsView::scrollContentsBy(dx, dy);
+	updateView();
+}
+
+void Drawing::updateView()
+{
+	if (!_graphReady)
+		return;
+	QRectF shown = mapToScene(viewport()->rect()).boundingRect();
+	// the items of a virtual scene follow the view
+	if (_graph->isVirtual())
+		_graph->setVisibleRegion(shown);
+	if (_minimap) {
+		_minimap->setViewRect(shown);
+		placeMinimap();
+	}
+}
+
+void Drawing::showInitialView()
+{
+	if (_initialView.isNull())
+		zoomToFit();
+	else
+		fitInView(_initialView, Qt::KeepAspectRatio);
+	updateView();
+}
+
+void Drawing::beginInteraction()
+{
+	if (!_graphReady)
+		return;
+	_idleTimer.start();
+	if (_interactive || _frameTime <= _frameBudget)
+		return;
+
+	_interactive = true;
+	setRenderHint(QPainter::Antialiasing, false);
+	setRenderHint(QPainter::SmoothPixmapTransform, false);
+	setOptimizationFlag(QGraphicsView::DontAdjustForAntialiasing, true);
+	setViewportUpdateMode(QGraphicsView::BoundingRectViewportUpdate);
+}
+
+void Drawing::endInteraction()
+{
+	if (!_interactive)
+		return;
+	_interactive = false;
+	setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
+	setOptimizationFlag(QGraphicsView::DontAdjustForAntialiasing, false);
+	setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate);
+	viewport()->update();
+}
+
+bool Drawing::viewportEvent(QEvent *event)
+{
+	if (event->type() == QEvent::Leave && _graphReady)
+		_graph->setHoveredNode(-1);
+	return QGraphicsView::viewportEvent(event);
 }
 
 void Drawing::paintEvent(QPaintEvent *event)
 {
 	if (!_alreadyShown && _graphReady) {
+		// the size of the viewport is only known now, but the view
+		// must not be changed while it is painted, the diagram is
+		// shown by the next paint
 		_alreadyShown = true;
-		zoomToFit();
+		QTimer::singleShot(0, this, SLOT(showInitialView()));
+		return;
 	}
 
-	QGraphicsView::paintEvent(event);
+	QElapsedTimer frame;
+	frame.start();
+	// the tiles are painted if they are all ready, the items otherwise
+	bool painted = false;
+	if (_tiles && _graphReady && !_graph->isBuilding() && !_graph->isAnimating()) {
+		QPainter painter(viewport());
+		painted = _tiles->paint(&painter, viewportTransform(), event->rect());
+	}
+	if (!painted)
+		QGraphicsView::paintEvent(event);
+
+	// the frames of the whole viewport at full quality tell whether the
+	// quality must be lowered during interactions
+	if (_graphReady && !_interactive && event->rect() == viewport()->rect()) {
+		qreal milliseconds = frame.nsecsElapsed() / 1000000.0;
+		_frameTime = _frameTime < 0 ? milliseconds : (3 * _frameTime + milliseconds) / 4;
+	}
 }
 
 void Drawing::showContextMenu(const QPoint &point)
@@ -86,10 +261,15 @@ void Drawing::showContextMenu(const QPoint &point)
 	QMenu contextualMenu;
 
 	QAction* resetAction = contextualMenu.addAction(tr("reset"));
+	resetAction->setEnabled(_graphReady);
+	QAction* compactAction = contextualMenu.addAction(tr("compact"));
+	compactAction->setEnabled(_graphReady && !_graph->isLayoutCoarse() && !_graph->isBuilding());
 	QAction* act = contextualMenu.exec(globalPos);
 	if (act) {
 		if (act == resetAction)
 			_graph->reset();
+		else if (act == compactAction)
+			_graph->compact();
 	}
 }
 
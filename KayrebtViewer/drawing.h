@@ -10,7 +10,12 @@
 #include <QWidget>
 #include <QGraphicsScene>
 #include <QGraphicsView>
+#include <QPointF>
+#include <QTimer>
 class Graph;
+class Minimap;
+class ProgressScene;
+class TileCache;
 
 /**
  * @brief This class represents the drawing area where a diagram is shown.
@@ -61,6 +66,49 @@ public slots:
 
 private slots:
 	void setGraphReady();
+	/**
+	 * @brief Decides which part of the diagram to show first, so that the
+	 * Graph builds it first.
+	 *
+	 * The whole diagram is shown, unless it is too big to be readable at
+	 * all, in which case its top is shown at scale @a MIN_INITIAL_SCALE.
+	 */
+	void chooseInitialView();
+	/**
+	 * @brief Remembers which node is at the center of the view before
+	 * the diagram is laid out again.
+	 */
+	void rememberAnchor();
+	/**
+	 * @brief Brings back the node remembered by rememberAnchor() at the
+	 * center of the view after the diagram has been laid out again.
+	 */
+	void restoreAnchor();
+	/**
+	 * @brief Centers the view on a point of the diagram.
+	 *
+	 * @param point the point, in scene coordinates
+	 */
+	void showPoint(const QPointF& point);
+	/**
+	 * @brief Goes back to full quality once the user has stopped moving
+	 * the view, see beginInteraction().
+	 */
+	void endInteraction();
+	/**
+	 * @brief Shows the part of the diagram chosen first, once the
+	 * diagram is ready and the Drawing is painted for the first time.
+	 */
+	void showInitialView();
+	/**
+	 * @brief Lets the diagram and the minimap know which part of the
+	 * diagram is shown.
+	 *
+	 * This is called each time the view is scrolled, zoomed or resized,
+	 * rather than from paintEvent(), since the items of a virtual scene
+	 * are created and removed according to the part shown.
+	 */
+	void updateView();
 
 signals:
 	void readyForDisplay();
@@ -77,14 +125,117 @@ protected:
 	 */
 	virtual void wheelEvent(QWheelEvent *event) override;
 	virtual void paintEvent(QPaintEvent *event) override;
+	virtual void resizeEvent(QResizeEvent *event) override;
+	/**
+	 * @brief Stops hovering the diagram when the mouse pointer leaves the
+	 * view.
+	 *
+	 * @param event the event received by the viewport
+	 *
+	 * @return true if, and only if, the event has been handled
+	 */
+	virtual bool viewportEvent(QEvent *event) override;
+	/**
+	 * @brief Lowers the quality while the view is scrolled, see
+	 * beginInteraction().
+	 *
+	 * @param dx the horizontal move, in pixels
+	 * @param dy the vertical move, in pixels
+	 */
+	virtual void scrollContentsBy(int dx, int dy) override;
 
 private:
+	/**
+	 * @brief Moves the minimap to the bottom right corner of the view.
+	 */
+	void placeMinimap();
+	/**
+	 * @brief Lowers the quality of the rendering while the user zooms or
+	 * moves the view, if painting the diagram at full quality is too
+	 * slow.
+	 *
+	 * The diagram is drawn without antialiasing, and the viewport is
+	 * updated by a single rectangle. The full quality comes back when
+	 * the user has been idle for @a INTERACTION_IDLE milliseconds.
+	 */
+	void beginInteraction();
+
 	/**
 	 * @brief the diagram displayed on the Drawing
 	 */
 	Graph *_graph;
+	/**
+	 * @brief the scene showing the progress of the construction of the
+	 * diagram, until it is ready
+	 */
+	ProgressScene *_placeholder;
 	bool _alreadyShown = false;
 	bool _graphReady = false;
+	/**
+	 * @brief the node kept at the center of the view when the diagram
+	 * is laid out again, -1 if there is none
+	 */
+	int _anchor = -1;
+	/**
+	 * @brief the position of the center of the view relative to @a
+	 * _anchor
+	 */
+	QPointF _anchorOffset;
+	/**
+	 * @brief the part of the diagram shown first, null until it is known
+	 */
+	QRectF _initialView;
+	/**
+	 * @brief the images of the diagram, null if setting "tile cache" is
+	 * 0
+	 */
+	TileCache *_tiles = nullptr;
+	/**
+	 * @brief the overview of the diagram, null until it is built or if
+	 * setting "minimap" is false
+	 */
+	Minimap *_minimap = nullptr;
+	/**
+	 * @brief whether the quality is lowered because the user is moving
+	 * the view
+	 */
+	bool _interactive = false;
+	/**
+	 * @brief the timer ending the interaction, restarted by each move of
+	 * the view
+	 */
+	QTimer _idleTimer;
+	/**
+	 * @brief the average time taken to paint the whole viewport at full
+	 * quality, in milliseconds, negative until it is known
+	 */
+	qreal _frameTime = -1;
+	/**
+	 * @brief the time above which painting the viewport is too slow to
+	 * keep the full quality during interactions, in milliseconds
+	 */
+	qreal _frameBudget;
+
+	/**
+	 * @brief the smallest scale at which the whole diagram is shown
+	 * first
+	 */
+	static constexpr qreal MIN_INITIAL_SCALE = 0.1;
+	/**
+	 * @brief the distance between the minimap and the corner of the
+	 * view, in pixels
+	 */
+	static const int MINIMAP_MARGIN = 10;
+	/**
+	 * @brief the time after the last move of the view at which the full
+	 * quality comes back, in milliseconds
+	 */
+	static const int INTERACTION_IDLE = 250;
+	/**
+	 * @brief the default value of setting "frame budget", in
+	 * milliseconds
+	 */
+	static const int DEFAULT_FRAME_BUDGET = 20;
 };
 
 #endif // DRAWING_H
@@ -7,13 +7,9 @@
 #ifndef EDGE_H
 #define EDGE_H
 
-#include <QGraphicsObject>
-#include <QGraphicsPathItem>
-#include <QGraphicsSimpleTextItem>
-#include <QGraphicsPolygonItem>
-#include <gvc.h>
 #include <types.h>
 #include "element.h"
+#include "scenegeometry.h"
 
 class Graph;
 
@@ -23,40 +19,68 @@ class Graph;
  */
 class Edge : public Element
 {
-	Q_OBJECT
 public:
 	/**
 	 * @brief Constructor.
 	 *
-	 * Builds the Edge from a GraphViz edge, in diagram \p graph.
+	 * Builds an Edge of diagram \p graph.
 	 *
-	 * @param v the GraphViz structure representing an edge
+	 * @param e the index of the edge in the diagram
+	 * @param geometry the shapes of the edge
 	 * @param graph the diagram in which the edge is added
-	 * @param parent the parent item, probebly the graph
 	 */
-	explicit Edge(Agedge_t *v, Graph* graph);
-
-	virtual ~Edge();
+	explicit Edge(int e, const EdgeGeometry& geometry, Graph* graph);
 	/**
 	 * @brief Mark the edge as invisible.
 	 */
-	virtual void hide();
+	virtual void hide() override;
+	/**
+	 * @brief Makes the Edge stand for another edge of the diagram.
+	 *
+	 * This is used to recycle the items of the edges which are scrolled
+	 * out of view. The state of the Edge is kept, it is up to the caller
+	 * to set it.
+	 *
+	 * @param e the index of the edge in the diagram
+	 * @param geometry the shapes of the edge
+	 */
+	void assign(int e, const EdgeGeometry& geometry);
+	/**
+	 * @brief Reroutes the Edge, keeping its state.
+	 *
+	 * @param geometry the new shapes of the edge
+	 */
+	void setGeometry(const EdgeGeometry& geometry);
 	/**
 	 * @brief Tells whether the Edge has an ancestor which is highlighted.
 	 *
 	 * @return true if and only if at least one ancestor is highlighted
 	 */
-	virtual bool hasHighlightedAncestor() const;
-	virtual void highlight() override;
-	virtual void unhighlight() override;
-
+	virtual bool hasHighlightedAncestor() const override;
+	/**
+	 * @brief Draws the line, the arrow head and the text of the Edge.
+	 */
 	void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+	/**
+	 * @brief Draws an edge.
+	 *
+	 * This function does not need an item and can be called from any
+	 * thread, to paint on an image.
+	 *
+	 * @param painter the painter to draw with
+	 * @param geometry the shapes of the edge
+	 * @param highlighted whether the edge is highlighted
+	 * @param labelThreshold the level of detail under which the label is
+	 * not drawn
+	 * @param shapeThreshold the level of detail under which the edge is
+	 * drawn as a polyline
+	 */
+	static void paintEdge(QPainter *painter, const EdgeGeometry& geometry, bool highlighted,
+						  qreal labelThreshold, qreal shapeThreshold);
 
-signals:
-
-public slots:
 	/**
-	 * @brief The slot is triggered when the Edge receives a double-click.
+	 * @brief The handler is triggered when the Edge receives a
+	 * double-click.
 	 *
 	 * @param UNUSED <i>unused</i>
 	 */
@@ -64,17 +88,13 @@ public slots:
 
 private:
 	/**
-	 * @brief the corresponding GraphViz edge
-	 */
-	Agedge_t* _gv_edge;
-	/**
-	 * @brief the text of the edge (possibly null)
+	 * @brief the index of the edge in the diagram
 	 */
-	QGraphicsSimpleTextItem* _label;
+	int _index;
 	/**
-	 * @brief the head of the edge
+	 * @brief the shapes of the edge
 	 */
-	QGraphicsPolygonItem* _arrowHead;
+	EdgeGeometry _geometry;
 
 friend class Graph;
 };
@@ -4,54 +4,95 @@
  * @date 2015-06-17
  * @brief Implementation of class Element
  */
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
 #include <QPen>
 #include <QBrush>
 #include <QRectF>
 #include "graph.h"
 #include "element.h"
+#include "labelcache.h"
 
 QPen Element::defaultPen = QPen(QBrush(QColor("mediumaquamarine")), 1, Qt::SolidLine, Qt::SquareCap, Qt::RoundJoin);
 QBrush Element::defaultBrush = QBrush(QColor("mediumaquamarine"));
 QPen Element::highlightPen = QPen(QBrush(QColor("red")), 3, Qt::SolidLine, Qt::SquareCap, Qt::RoundJoin);
+QPen Element::labelPen = QPen(Qt::black);
 
 Element::Element(Graph *graph, QGraphicsItem *parent) :
-	QGraphicsObject(parent),
+	QGraphicsItem(parent),
 	_graph(graph)
 {
 }
 
 Element::~Element()
 {
-	delete _inner;
+}
+
+void Element::setBounds(const QRectF& shape, const QRectF& contents)
+{
+	prepareGeometryChange();
+	// the widest pen is taken into account so that highlighting the
+	// Element does not change its extent
+	qreal margin = qMax(defaultPen.widthF(), highlightPen.widthF()) / 2;
+	_shapeRect = shape.adjusted(-margin, -margin, margin, margin);
+	_boundingRect = _shapeRect;
+	if (!contents.isNull())
+		_boundingRect |= contents.adjusted(-margin, -margin, margin, margin);
 }
 
 QRectF Element::boundingRect() const
 {
-	return _inner->boundingRect();
+	return _boundingRect;
 }
 
-void Element::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+QPainterPath Element::shape() const
 {
-	_inner->paint(painter, option, widget);
+	QPainterPath path;
+	path.addRect(_shapeRect);
+	return path;
+}
+
+const QPen& Element::getPen(bool highlighted)
+{
+	return highlighted ? highlightPen : defaultPen;
+}
+
+qreal Element::levelOfDetail(const QPainter* painter)
+{
+	return QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+}
+
+void Element::paintLabel(QPainter* painter, const QString& text, const QRectF& rect)
+{
+	if (text.isEmpty())
+		return;
+	painter->setPen(labelPen);
+	painter->setFont(Graph::MONOSPACE_FONT);
+	painter->drawStaticText(rect.topLeft(), LabelCache::local().get(text));
 }
 
 void Element::highlight()
 {
-	_inner->setPen(highlightPen);
+	if (!_highlighted) {
+		_highlighted = true;
+		update();
+	}
 }
 
 void Element::unhighlight()
 {
-	_inner->setPen(defaultPen);
+	if (_highlighted) {
+		_highlighted = false;
+		update();
+	}
 }
 
 bool Element::isHighlighted() const
 {
-	return _inner->pen() == highlightPen;
+	return _highlighted;
 }
 
 bool Element::isUnhighlighted() const
 {
-	return _inner->pen() == defaultPen;
+	return !_highlighted;
 }
-
@@ -7,18 +7,23 @@
 #ifndef ELEMENT_H
 #define ELEMENT_H
 
-#include <QGraphicsObject>
-#include <QAbstractGraphicsShapeItem>
 #include <QGraphicsItem>
+#include <QPainterPath>
+#include <QPen>
+#include <QBrush>
+#include <QRectF>
 
 class Graph;
 
 /**
  * @brief Parent class of objects belonging to diagrams.
+ *
+ * Diagrams may have tens of thousands of elements, so an Element is a single
+ * plain QGraphicsItem, not a QObject, holding its shapes and its state and
+ * painting them itself, rather than a tree of one item per shape.
  */
-class Element : public QGraphicsObject
+class Element : public QGraphicsItem
 {
-	Q_OBJECT
 public:
 	/**
 	 * @brief Unique constructor.
@@ -31,25 +36,29 @@ public:
 	 */
 	explicit Element(Graph* graph, QGraphicsItem *parent = nullptr);
 	/**
-	 * @brief Destroys the Element, and frees the associated GraphViz
-	 * resources.
+	 * @brief Destroys the Element.
 	 */
 	virtual ~Element();
 	/**
-	 * @brief Displays the Element in the drawing area. Reimplementation
-	 * from QGraphicsObject.
+	 * @brief Reimplemented from QGraphicsItem
+	 *
+	 * @return the rectangle containing everything the Element paints,
+	 * whether it is highlighted or not
 	 */
-	virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
+	virtual QRectF boundingRect() const override;
 	/**
-	 * @brief Reimplemented from QGraphicsObject
+	 * @brief Reimplemented from QGraphicsItem
 	 *
-	 * The default implementation of boundingRect() in the present class
-	 * might need to be rewritten, if the item bounds are bigger than
-	 * those of \a _inner.
+	 * The Element reacts to the mouse in the bounding rectangle of its
+	 * main shape, not including the text or the arrow head.
 	 *
-	 * @return _inner->boundingRect()
+	 * @return the bounding rectangle of the main shape of the Element
+	 */
+	virtual QPainterPath shape() const override;
+	/**
+	 * @brief Marks the Element as invisible in the diagram and hides it.
 	 */
-	virtual QRectF boundingRect() const;
+	virtual void hide() = 0;
 	/**
 	 * @brief Highlights the Element, displaying it in a more eye-catching
 	 * fashion.
@@ -69,7 +78,7 @@ public:
 	 * @brief Tells whether the Element is highlighted.
 	 *
 	 * @return true if, and only if, the Element is drawn with the \a
-	 * Element::hilightPen.
+	 * Element::highlightPen.
 	 */
 	bool isHighlighted() const;
 	/**
@@ -87,19 +96,62 @@ public:
 	 */
 	virtual bool hasHighlightedAncestor() const = 0;
 
-signals:
-
-public slots:
-
 protected:
+	/**
+	 * @brief Sets the extent of the Element.
+	 *
+	 * This must be called by subclasses each time their shapes change.
+	 *
+	 * @param shape the bounding rectangle of the main shape of the Element
+	 * @param contents the bounding rectangle of everything else painted
+	 * by the Element
+	 */
+	void setBounds(const QRectF& shape, const QRectF& contents = QRectF());
+	/**
+	 * @brief Gives the pen to draw an Element with.
+	 *
+	 * @param highlighted whether the Element is highlighted
+	 *
+	 * @return \a highlightPen if the Element is highlighted, \a defaultPen
+	 * otherwise
+	 */
+	static const QPen& getPen(bool highlighted);
+	/**
+	 * @brief Gives the level of detail at which the Element is painted.
+	 *
+	 * @param painter the painter the Element is painted with
+	 *
+	 * @return the scale at which the diagram is shown, 1 when it is
+	 * shown at its actual size
+	 */
+	static qreal levelOfDetail(const QPainter* painter);
+	/**
+	 * @brief Draws a label of the Element.
+	 *
+	 * The labels with the same text share their layout, see LabelCache.
+	 *
+	 * @param painter the painter to draw with
+	 * @param text the text of the label, possibly empty
+	 * @param rect the rectangle occupied by the text
+	 */
+	static void paintLabel(QPainter* painter, const QString& text, const QRectF& rect);
+
 	/**
 	 * @brief the diagram to which the Element belongs
 	 */
 	Graph* _graph;
 	/**
-	 * @brief the main component of the Element shape
+	 * @brief whether the Element is highlighted
+	 */
+	bool _highlighted = false;
+	/**
+	 * @brief the bounding rectangle of the main shape of the Element
 	 */
-	QAbstractGraphicsShapeItem* _inner;
+	QRectF _shapeRect;
+	/**
+	 * @brief the bounding rectangle of everything painted by the Element
+	 */
+	QRectF _boundingRect;
 
 	/**
 	 * @brief the pen used to draw the Element under normal conditions
@@ -113,6 +165,10 @@ protected:
 	 * @brief the brush used to paint the Element
 	 */
 	static QBrush defaultBrush;
+	/**
+	 * @brief the pen used to write the labels
+	 */
+	static QPen labelPen;
 };
 
 #endif // ELEMENT_H
@@ -4,6 +4,7 @@
  * @date 2015-06-17
  * @brief Implementation of class Graph
  */
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <vector>
@@ -13,189 +14,834 @@
 #include <QGraphicsPathItem>
 #include <QApplication>
 #include <QGraphicsView>
+#include <QGraphicsSceneMouseEvent>
 #include <QPair>
-#include <QQueue>
 #include <QDebug>
 #include <QEvent>
 #include <QFileInfo>
 #include <QSettings>
-#include <QMutex>
+#include <QFile>
+#include <QFontMetricsF>
 #include <QtCore>
-#include <types.h>
+#if QT_VERSION >= 0x050000
+#include <QtConcurrent/QtConcurrentRun>
+#else
+#include <QtConcurrentRun>
+#endif
 #include "viewer.h"
 #include "graph.h"
 #include "edge.h"
 #include "node.h"
+#include "diagramstore.h"
+#include "dotreader.h"
+#include "layeredlayout.h"
+#include "layoutjob.h"
+#include "layoutscheduler.h"
+#include "prefetcher.h"
 #include "hyperlinkactivatedevent.h"
 #include "nodehoverevent.h"
 
-const qreal Graph::DOT_DEFAULT_DPI = 72.0;
-const QFont Graph::MONOSPACE_FONT = QFont("Monospace", 15, QFont::Normal);
+const QFont Graph::MONOSPACE_FONT = QFont(GraphLayout::FONT_FAMILY, GraphLayout::FONT_POINT_SIZE, QFont::Normal);
+const qreal Graph::DEFAULT_LABEL_DETAIL_THRESHOLD = 0.4;
+const qreal Graph::DEFAULT_SHAPE_DETAIL_THRESHOLD = 0.15;
 
-QMutex Graph::_graphviz;
+Graph::Graph(quint64 id, const QString& filename, QObject* parent) : QGraphicsScene(parent), _id(id), _file(filename), _filename(filename)
+{
+	for (int stage = 0 ; stage < STAGE_COUNT ; stage++)
+		_stageTimes[stage] = -1;
+	_stageTimer.start();
 
-namespace {
-extern "C" {
-	typedef struct
-	{
-		Agrec_t h;
-		Node* node;
-	} Kayrebtnodeinfo_t;
+	// a diagram linked from the previous one may already be there
+	_laidOut = Prefetcher::instance().lookup(filename, _data, _layout);
+	if (!_laidOut)
+		readFile();
+	_stageTimes[PARSE_STAGE] = _stageTimer.elapsed();
 
-	typedef struct
-	{
-		Agrec_t h;
-		Edge* edge;
-	} Kayrebtedgeinfo_t;
-}
+	// the style of the elements is only read once, their state is then
+	// kept in bit arrays
+	_nodeHidden.resize(_data.getNodeCount());
+	_nodeTouched.resize(_data.getNodeCount());
+	for (int v = 0 ; v < _data.getNodeCount() ; v++)
+		if (_data.getNodeStyle(v) == "invisible")
+			markNodeHidden(v);
+	_edgeHidden.resize(_data.getEdgeCount());
+	_edgeTouched.resize(_data.getEdgeCount());
+	for (int e = 0 ; e < _data.getEdgeCount() ; e++)
+		if (_data.getEdgeStyle(e) == "invisible")
+			markEdgeHidden(e);
 
-	inline Node* getNode(Agnode_t* n) {
-		Kayrebtnodeinfo_t* k = reinterpret_cast<Kayrebtnodeinfo_t*>(aggetrec(n,"kayrebt",false));
-		return k ? k->node : nullptr;
-	}
+	// fonts are only measured here, in the GUI thread
+	QFontMetricsF metrics(MONOSPACE_FONT);
+	_charSize = QSizeF(metrics.width(QChar('M')), metrics.lineSpacing());
+	QSettings settings;
+	_labelDetailThreshold = settings.value("label detail threshold", DEFAULT_LABEL_DETAIL_THRESHOLD).toReal();
+	_shapeDetailThreshold = settings.value("shape detail threshold", DEFAULT_SHAPE_DETAIL_THRESHOLD).toReal();
+	_reachable.setMaxCost(REACHABLE_CACHE_SIZE);
+	_hoverTimer.setSingleShot(true);
+	_hoverTimer.setInterval(settings.value("hover delay", DEFAULT_HOVER_DELAY).toInt());
+	connect(&_hoverTimer, SIGNAL(timeout()), this, SLOT(hoverDwelled()));
+	connect(&_reachableWatcher, SIGNAL(finished()), this, SLOT(reachableComputed()));
+	connect(&_geometryWatcher, SIGNAL(finished()), this, SLOT(geometryComputed()));
 
-	inline void setNode(Agnode_t* n, Node* node) {
-		Kayrebtnodeinfo_t* k = reinterpret_cast<Kayrebtnodeinfo_t*>(aggetrec(n,"kayrebt",false));
-		if (k)
-			k->node = node;
-	}
+	_animation.setDuration(400);
+	_animation.setCurveShape(QTimeLine::EaseInOutCurve);
+	connect(&_animation, SIGNAL(valueChanged(qreal)), this, SLOT(animationStep(qreal)));
+}
 
-	inline Edge* getEdge(Agedge_t* e) {
-		Kayrebtedgeinfo_t* k = reinterpret_cast<Kayrebtedgeinfo_t*>(aggetrec(e,"kayrebt",false));
-		return k ? k->edge : nullptr;
+void Graph::readFile()
+{
+	const DiagramStore& store = DiagramStore::instance();
+	int entry = store.find(_filename);
+	if (entry >= 0) {
+		_dot = store.readDot(entry);
+		_laidOut = store.readLayout(entry, _layout);
+	} else {
+		if (!_file.open(QIODevice::ReadOnly))
+			throw std::runtime_error("Couldn't open input graph");
+		// the text is read in place if possible, it is only needed
+		// until the layout job is submitted
+		if (_file.size() > 0)
+			_mapped = _file.map(0, _file.size());
+		if (_mapped)
+			_dot = QByteArray::fromRawData(reinterpret_cast<const char*>(_mapped), _file.size());
+		else
+			_dot = _file.readAll();
 	}
 
-	inline void setEdge(Agedge_t* e, Edge* edge) {
-		Kayrebtedgeinfo_t* k = reinterpret_cast<Kayrebtedgeinfo_t*>(aggetrec(e,"kayrebt",false));
-		if (k)
-			k->edge = edge;
+	try {
+		_data = DotReader::read(_dot.constData(), _dot.size());
+	} catch (std::runtime_error& e) {
+		throw std::runtime_error(std::string("Couldn't parse graph from input file: ") + e.what());
 	}
 }
 
-Graph::Graph(quint64 id, const QString& filename, QObject* parent) : QGraphicsScene(parent), _id(id), _gv_con(Viewer::GRAPHVIZ_CONTEXT), _graph(), _filename(filename)
+Graph::~Graph()
+{
+	if (_job)
+		LayoutScheduler::instance().cancel(_job);
+	releaseDot();
+}
+
+void Graph::build()
 {
-	std::FILE* fp = fopen(qPrintable(filename), "r");
-	if (fp == nullptr)
-		throw std::runtime_error("Couldn't open input graph");
+	_stageTimer.restart();
+	if (_laidOut) {
+		releaseDot();
+		// let the caller connect to the signals before the diagram is
+		// built
+		QTimer::singleShot(0, this, SLOT(layoutFinished()));
+		return;
+	}
 
-	_graph = agread(fp, nullptr);
-	if (!_graph)
-		throw std::runtime_error("Couldn't parse graph from input file");
+	_job = LayoutScheduler::instance().submit(_dot);
+	releaseDot();
+	connect(_job, SIGNAL(started()), this, SLOT(layoutStarted()));
+	connect(_job, SIGNAL(finished()), this, SLOT(layoutFinished()));
+	connect(_job, SIGNAL(failed(QString)), this, SLOT(layoutFailed(QString)));
 
-	aginit(_graph, AGNODE, "kayrebt", sizeof(Kayrebtnodeinfo_t), false);
-	aginit(_graph, AGEDGE, "kayrebt", sizeof(Kayrebtedgeinfo_t), false);
-	_dpi = QString(agget(_graph,"dpi")).toDouble(); // cannot access through GD_drawing(_graph)->_dpi as the layout isn't done yet
-	if (_dpi == 0)
-		_dpi = 96.0;
+	// big diagrams are shown with a coarse layout while GraphViz is at
+	// work
+	int threshold = QSettings().value("progressive layout threshold", 2000).toInt();
+	if (!_job->isFromCache() && threshold > 0 && _data.getNodeCount() >= threshold) {
+		_layout = LayeredLayout::compute(_data, _charSize);
+		_coarseLayout = true;
+		layoutReady();
+	} else if (_job->isStarted()) { // the diagram was being prefetched
+		layoutStarted();
+	}
+}
 
-	_sourceFilename = QString(agget(_graph,"file"));
-	_sourceLineNumber = QString(agget(_graph,"line")).toInt();
+void Graph::cancel()
+{
+	if (!_job)
+		return;
 
-	setAttrs();
-	connect(this, SIGNAL(layoutDone()), this, SLOT(doBuild()));
+	LayoutScheduler::instance().cancel(_job);
+	_job = nullptr;
+	if (_coarseLayout) {
+		_coarseLayout = false; // the coarse layout stays
+		return;
+	}
+	emit graphFailed(tr("The construction of the diagram was cancelled."));
 }
 
-Graph::~Graph()
+void Graph::computeGeometry()
 {
-	_graphviz.lock();
-	gvFreeLayout(_gv_con, _graph);
-	_graphviz.unlock();
-	agclose(_graph);
+	// a computation in progress for a previous layout is simply ignored
+	_geometryLayout = _layout;
+	_geometryWatcher.setFuture(QtConcurrent::run(&SceneGeometry::compute, _geometryLayout, _charSize));
 }
 
-void Graph::build()
+void Graph::geometryComputed()
 {
-	QtConcurrent::run(this, &Graph::doLayout);
+	_geometry = _geometryWatcher.result();
+	if (_stageTimes[BUILD_STAGE] < 0 && !_building) {
+		doBuild();
+	} else {
+		applyGeometry();
+		// the items still to be built need the geometry, those of the
+		// virtual scene are computed one by one from the layout
+		if (!_building)
+			_geometry = SceneGeometry();
+	}
 }
 
 void Graph::doBuild()
 {
-	for (Agnode_t* v = agfstnode(_graph) ; v ; v = agnxtnode(_graph,v)) {
-		addNode(v);
-		for (Agedge_t* e = agfstout(_graph,v) ; e ; e = agnxtout(_graph,e))
-			addEdge(e);
+	if (_geometry.nodes.size() != _data.getNodeCount() || _geometry.edges.size() != _data.getEdgeCount()) {
+		emit graphFailed(tr("The layout does not match the diagram."));
+		return;
+	}
+
+	setSceneRect(_geometry.sceneRect);
+	_nodes.resize(_data.getNodeCount());
+	_edges.resize(_data.getEdgeCount());
+	_nodeHighlighted.fill(false, _data.getNodeCount());
+	_edgeHighlighted.fill(false, _data.getEdgeCount());
+
+	// the view says which part of the diagram it shows first
+	_initialView = QRectF();
+	emit aboutToBuild();
+	if (_initialView.isNull())
+		_initialView = _geometry.sceneRect;
+
+	indexGeometry();
+	QSettings settings;
+	int elements = _data.getNodeCount() + _data.getEdgeCount();
+	int threshold = settings.value("virtual scene threshold", DEFAULT_VIRTUAL_SCENE_THRESHOLD).toInt();
+	_virtualScene = threshold > 0 && elements > threshold;
+	// the items do not move once built, a BSP tree speeds up painting
+	// big scenes, but the items of a virtual scene come and go all the
+	// time, and hit-testing does not need the index of the scene
+	QString index = settings.value("scene index", "automatic").toString();
+	if (index == "bsp" || (index == "automatic" && !_virtualScene && elements > BSP_INDEX_THRESHOLD))
+		setItemIndexMethod(QGraphicsScene::BspTreeIndex);
+	else
+		setItemIndexMethod(QGraphicsScene::NoIndex);
+	if (_virtualScene) {
+		// the items are created when the view is known, see
+		// setVisibleRegion()
+		_stageTimes[BUILD_STAGE] = _stageTimer.elapsed();
+		emit stageFinished(BUILD_STAGE, _stageTimes[BUILD_STAGE]);
+		emit graphBuilt();
+		buildDone();
+		return;
+	}
+
+	// the nodes in view come first, then the others, closest first
+	QPointF center = _initialView.center();
+	QVector<bool> inView(_data.getNodeCount());
+	QVector<qreal> distance(_data.getNodeCount());
+	_buildOrder.resize(_data.getNodeCount());
+	_initialCount = 0;
+	for (int v = 0 ; v < _data.getNodeCount() ; v++) {
+		QRectF box = _geometry.nodes[v].outline.boundingRect();
+		QPointF d = box.center() - center;
+		inView[v] = _initialView.intersects(box);
+		distance[v] = d.x() * d.x() + d.y() * d.y();
+		_buildOrder[v] = v;
+		if (inView[v])
+			_initialCount++;
+	}
+	std::sort(_buildOrder.begin(), _buildOrder.end(), [&inView, &distance](int a, int b) {
+		if (inView[a] != inView[b])
+			return inView[a];
+		return distance[a] < distance[b];
+	});
+	_buildNext = 0;
+	_building = true;
+	buildSlice();
+}
+
+void Graph::buildSlice()
+{
+	QElapsedTimer slice;
+	slice.start();
+	// the edges are grouped by tail, as in the layout, they are built
+	// along with their tail
+	while (_buildNext < _buildOrder.size() && slice.elapsed() < BUILD_SLICE) {
+		int v = _buildOrder[_buildNext++];
+		addNode(v, _geometry.nodes[v]);
+		for (int e = _data.getOutEdgesBegin(v) ; e < _data.getOutEdgesEnd(v) ; e++)
+			addEdge(e, _geometry.edges[e]);
+		if (_buildNext == _initialCount)
+			break; // show the view as soon as possible
+	}
+
+	if (_buildNext >= _initialCount && _stageTimes[BUILD_STAGE] < 0) {
+		_stageTimes[BUILD_STAGE] = _stageTimer.elapsed();
+		emit stageFinished(BUILD_STAGE, _stageTimes[BUILD_STAGE]);
+		emit graphBuilt();
+	}
+
+	if (_buildNext < _buildOrder.size()) {
+		QTimer::singleShot(0, this, SLOT(buildSlice()));
+		return;
 	}
-	emit graphBuilt();
+	buildDone();
 }
 
-void Graph::pimpSubTree(Node *n, std::function<void (Element &)> f, std::function<bool (Element&)> test, bool incomingEdgesAreConcerned)
+void Graph::buildDone()
 {
-	Agnode_t* v = n->_gv_node;
-	QQueue<Agnode_t*> waitingNodes;
-	QList<Agnode_t*> finishedNodes;
+	_building = false;
+	_geometry = SceneGeometry();
+	_buildOrder = QVector<int>();
 
-	waitingNodes.enqueue(v);
-	while (!waitingNodes.empty()) {
-		Agnode_t* currentNode = waitingNodes.dequeue();
-		f(*getNode(currentNode));
+	Prefetcher::instance().prefetch(*this);
+}
+
+void Graph::pimpSubTree(int v, std::function<void (Element &)> f, std::function<bool (Element&)> test, bool incomingEdgesAreConcerned)
+{
+	pimpSubTreeFrom(v, f, test, incomingEdgesAreConcerned);
+	emit elementsChanged(_changedAreas);
+	_changedAreas.clear();
+}
+
+void Graph::pimpSubTreeFrom(int v, const std::function<void (Element &)>& f, const std::function<bool (Element&)>& test, bool incomingEdgesAreConcerned)
+{
+	// breadth-first, the queue is never shrunk and each node enters it
+	// at most once
+	QVector<int> queue;
+	QBitArray queued(_data.getNodeCount());
+	queue.append(v);
+	queued.setBit(v);
+	for (int next = 0 ; next < queue.size() ; next++) {
+		int currentNode = queue[next];
+		applyToNode(currentNode, f);
 		if (incomingEdgesAreConcerned) {
-			for (Agedge_t* in = agfstin(_graph,currentNode) ; in ; in = agnxtin(_graph,in)) {
-				f(*getEdge(in));
-			}
+			for (int i = _data.getInEdgesBegin(currentNode) ; i < _data.getInEdgesEnd(currentNode) ; i++)
+				applyToEdge(_data.getInEdge(i), f);
 		}
 
-		for (Agedge_t* e = agfstout(_graph,currentNode) ; e ; e = agnxtout(_graph,e)) {
-			Agnode_t* nextNode = aghead(e);
+		for (int e = _data.getOutEdgesBegin(currentNode) ; e < _data.getOutEdgesEnd(currentNode) ; e++) {
+			int nextNode = _data.getEdgeHead(e);
+			applyToEdge(e, f);
+			if (queued.testBit(nextNode))
+				continue;
+			// f may change the result of the test, a node rejected
+			// now may be accepted from another of its tails later
 			bool toProcess = true;
 			if (test != nullptr) {
-				for (Agedge_t* in = agfstin(_graph,nextNode) ; in && toProcess ; in = agnxtin(_graph,in)) {
-					Node* tested = getNode(agtail(in));
-					if (test(*tested))
+				for (int i = _data.getInEdgesBegin(nextNode) ; i < _data.getInEdgesEnd(nextNode) && toProcess ; i++) {
+					if (testNode(_data.getEdgeTail(_data.getInEdge(i)), test))
 						toProcess = false;
 				}
 			}
-			f(*getEdge(e));
-			if (toProcess && !waitingNodes.contains(nextNode) && !finishedNodes.contains(nextNode)) {
-				waitingNodes.enqueue(nextNode);
+			if (toProcess) {
+				queued.setBit(nextNode);
+				queue.append(nextNode);
+			}
+		}
+	}
+}
+
+QVector<int> Graph::reachableFrom(int v)
+{
+	QVector<int>* cached = _reachable.object(v);
+	if (cached)
+		return *cached;
+
+	QVector<int> ranges = computeReachable(_data, v);
+	_reachable.insert(v, new QVector<int>(ranges), ranges.size());
+	return ranges;
+}
+
+QVector<int> Graph::computeReachable(const DiagramData& data, int v)
+{
+	QVector<int> queue;
+	QBitArray queued(data.getNodeCount());
+	queue.append(v);
+	queued.setBit(v);
+	for (int next = 0 ; next < queue.size() ; next++) {
+		int currentNode = queue[next];
+		for (int e = data.getOutEdgesBegin(currentNode) ; e < data.getOutEdgesEnd(currentNode) ; e++) {
+			int nextNode = data.getEdgeHead(e);
+			if (!queued.testBit(nextNode)) {
+				queued.setBit(nextNode);
+				queue.append(nextNode);
+			}
+		}
+	}
+
+	// the nodes are numbered in the order of the file, which mostly
+	// follows the flow of the diagram, the successors of a node come in
+	// long runs of consecutive indices
+	std::sort(queue.begin(), queue.end());
+	QVector<int> ranges;
+	for (int node : queue) {
+		if (!ranges.isEmpty() && ranges.last() == node)
+			ranges.last() = node + 1;
+		else
+			ranges << node << node + 1;
+	}
+	ranges.squeeze();
+	return ranges;
+}
+
+void Graph::highlightReachable(int v, bool highlighted)
+{
+	highlightRanges(reachableFrom(v), highlighted);
+}
+
+void Graph::highlightRanges(const QVector<int>& ranges, bool highlighted)
+{
+	QRectF changed;
+	for (int i = 0 ; i < ranges.size() ; i += 2) {
+		for (int node = ranges[i] ; node < ranges[i + 1] ; node++) {
+			if (setNodeHighlighted(node, highlighted)) {
+				_changedAreas.append(_nodeIndex.getRect(node));
+				changed |= _changedAreas.last();
+			}
+			for (int e = _data.getOutEdgesBegin(node) ; e < _data.getOutEdgesEnd(node) ; e++) {
+				if (setEdgeHighlighted(e, highlighted)) {
+					_changedAreas.append(_edgeIndex.getRect(e));
+					changed |= _changedAreas.last();
+				}
 			}
 		}
-		finishedNodes.append(currentNode);
 	}
+	if (_changedAreas.isEmpty())
+		return;
+
+	// one update of the scene rather than one per item, the highlight
+	// pen being accounted for in the bounding rectangles of the items
+	const qreal margin = 2;
+	update(changed.adjusted(-margin, -margin, margin, margin));
+	emit elementsChanged(_changedAreas);
+	_changedAreas.clear();
+}
+
+void Graph::touchNode(int v)
+{
+	if (!_nodeTouched.testBit(v)) {
+		_nodeTouched.setBit(v);
+		_touchedNodes.append(v);
+	}
+}
+
+void Graph::touchEdge(int e)
+{
+	if (!_edgeTouched.testBit(e)) {
+		_edgeTouched.setBit(e);
+		_touchedEdges.append(e);
+	}
+}
+
+void Graph::markNodeHidden(int v)
+{
+	_nodeHidden.setBit(v);
+	touchNode(v);
+}
+
+void Graph::markEdgeHidden(int e)
+{
+	_edgeHidden.setBit(e);
+	touchEdge(e);
+}
+
+bool Graph::isNodeHidden(int v) const
+{
+	return _nodeHidden.testBit(v);
+}
+
+bool Graph::isEdgeHidden(int e) const
+{
+	return _edgeHidden.testBit(e);
+}
+
+bool Graph::setNodeHighlighted(int v, bool highlighted)
+{
+	if (_nodes[v] ? _nodes[v]->_highlighted == highlighted : _nodeHighlighted.testBit(v) == highlighted)
+		return false;
+	if (_nodes[v])
+		_nodes[v]->_highlighted = highlighted;
+	else
+		_nodeHighlighted.setBit(v, highlighted);
+	touchNode(v);
+	return true;
+}
+
+bool Graph::setEdgeHighlighted(int e, bool highlighted)
+{
+	if (_edges[e] ? _edges[e]->_highlighted == highlighted : _edgeHighlighted.testBit(e) == highlighted)
+		return false;
+	if (_edges[e])
+		_edges[e]->_highlighted = highlighted;
+	else
+		_edgeHighlighted.setBit(e, highlighted);
+	touchEdge(e);
+	return true;
 }
 
 void Graph::pimpSubTree(Edge *e, std::function<void (Element &)> f, std::function<bool (Element&)> test)
 {
 	f(*e);
-	Node *n = getNode(aghead(e->_gv_edge));
-	if (!test(*n))
-		pimpSubTree(n,f,test);
+	touchEdge(e->_index);
+	_changedAreas.append(_edgeIndex.getRect(e->_index));
+	int head = _data.getEdgeHead(e->_index);
+	if (!testNode(head, test))
+		pimpSubTreeFrom(head, f, test, false);
+	emit elementsChanged(_changedAreas);
+	_changedAreas.clear();
 }
 
-const Agraph_t *Graph::getAgraph() const
+void Graph::applyToNode(int v, const std::function<void (Element&)>& f)
 {
-	return _graph;
+	touchNode(v);
+	_changedAreas.append(_nodeIndex.getRect(v));
+	if (_nodes[v]) {
+		f(*_nodes[v]);
+		return;
+	}
+	// the node has no item, its state is kept aside
+	Node& node = detachedNode(v);
+	f(node);
+	_nodeHighlighted.setBit(v, node.isHighlighted());
+}
+
+void Graph::applyToEdge(int e, const std::function<void (Element&)>& f)
+{
+	touchEdge(e);
+	_changedAreas.append(_edgeIndex.getRect(e));
+	if (_edges[e]) {
+		f(*_edges[e]);
+		return;
+	}
+	Edge& edge = detachedEdge(e);
+	f(edge);
+	_edgeHighlighted.setBit(e, edge.isHighlighted());
+}
+
+bool Graph::testNode(int v, const std::function<bool (Element&)>& test)
+{
+	if (_nodes[v])
+		return test(*_nodes[v]);
+	return test(detachedNode(v));
+}
+
+Node& Graph::detachedNode(int v)
+{
+	if (!_detachedNode)
+		_detachedNode.reset(new Node(v, NodeGeometry(), this));
+	// only the state matters, hiding the node marks it in the data
+	_detachedNode->_index = v;
+	_detachedNode->setVisible(!_nodeHidden.testBit(v));
+	if (_nodeHighlighted.testBit(v))
+		_detachedNode->highlight();
+	else
+		_detachedNode->unhighlight();
+	return *_detachedNode;
+}
+
+Edge& Graph::detachedEdge(int e)
+{
+	if (!_detachedEdge)
+		_detachedEdge.reset(new Edge(e, EdgeGeometry(), this));
+	_detachedEdge->_index = e;
+	_detachedEdge->setVisible(!_edgeHidden.testBit(e));
+	if (_edgeHighlighted.testBit(e))
+		_detachedEdge->highlight();
+	else
+		_detachedEdge->unhighlight();
+	return *_detachedEdge;
+}
+
+const DiagramData& Graph::getData() const
+{
+	return _data;
 }
 
 qreal Graph::getDpi() const
 {
-	return _dpi;
+	return _data.getDpi();
 }
 
 const QString& Graph::getSourceFilename() const
 {
-	return _sourceFilename;
+	return _data.getSourceFile();
 }
 
 int Graph::getSourceLine() const
 {
-	return _sourceLineNumber;
+	return _data.getSourceLine();
+}
+
+void Graph::releaseDot()
+{
+	_dot = QByteArray();
+	if (_mapped) {
+		_file.unmap(_mapped);
+		_mapped = nullptr;
+	}
+	_file.close();
 }
 
-void Graph::setAttrs()
+void Graph::layoutStarted()
 {
-	agattr(_graph, AGNODE, "fontname", const_cast<char*>(qPrintable(MONOSPACE_FONT.family())));
-	agattr(_graph, AGNODE, "fontsize", const_cast<char*>(qPrintable(QString("%1").arg(MONOSPACE_FONT.pointSizeF()*DOT_DEFAULT_DPI/_dpi))));
+	if (_coarseLayout)
+		return; // the layout stage is already over
+	_stageTimer.restart();
+	emit stageStarted(LAYOUT_STAGE);
 }
 
-void Graph::doLayout()
+void Graph::layoutFinished()
 {
-	_graphviz.lock();
-	gvFreeLayout(_gv_con, _graph);
-	gvLayout(_gv_con, _graph, "dot");
-	_graphviz.unlock();
-	setSceneRect(GD_bb(_graph).LL.x*(_dpi/DOT_DEFAULT_DPI), GD_bb(_graph).LL.y*(_dpi/DOT_DEFAULT_DPI),
-				 GD_bb(_graph).UR.x*(_dpi/DOT_DEFAULT_DPI), GD_bb(_graph).UR.y*(_dpi/DOT_DEFAULT_DPI));
+	if (_laidOut) {
+		_layoutFromCache = true;
+	} else {
+		_layout = _job->getLayout();
+		_layoutFromCache = _job->isFromCache();
+		_job = nullptr;
+	}
+
+	if (_coarseLayout) {
+		_coarseLayout = false;
+		_compacted = false;
+		applyLayout();
+		return;
+	}
+	layoutReady();
+}
+
+void Graph::layoutReady()
+{
+	_stageTimes[LAYOUT_STAGE] = _stageTimer.elapsed();
+	emit stageFinished(LAYOUT_STAGE, _stageTimes[LAYOUT_STAGE]);
+
+	_stageTimer.restart();
+	emit stageStarted(BUILD_STAGE);
 	emit layoutDone();
+	computeGeometry();
+}
+
+void Graph::applyLayout()
+{
+	// the elements may not be built yet, in which case they will be
+	// built directly with the new layout
+	computeGeometry();
+}
+
+void Graph::applyGeometry()
+{
+	emit layoutAboutToChange();
+	for (unsigned int v = 0 ; v < _nodes.size() ; v++)
+		if (_nodes[v])
+			_nodes[v]->setGeometry(_geometry.nodes[v]);
+	for (unsigned int e = 0 ; e < _edges.size() ; e++)
+		if (_edges[e])
+			_edges[e]->setGeometry(_geometry.edges[e]);
+	setSceneRect(_geometry.sceneRect);
+	indexGeometry();
+	if (_virtualScene) {
+		// the elements around the view are not the same any more
+		_materialized = QRectF();
+		setVisibleRegion(_visibleRegion);
+	}
+	emit layoutChanged();
+
+	if (_animationPending) {
+		_animationPending = false;
+		animationStep(0);
+		_animation.start();
+	}
+}
+
+void Graph::compact()
+{
+	if (_coarseLayout || _building || _nodes.size() != unsigned(_layout.nodes.size()))
+		return;
+
+	QVector<bool> visible(_nodes.size());
+	for (unsigned int v = 0 ; v < _nodes.size() ; v++)
+		visible[v] = !_nodeHidden.testBit(v);
+	if (!_compacted)
+		_fullLayout = _layout;
+	// compacting the full layout rather than the current one leaves the
+	// nodes where they were if nothing has been hidden since
+	animateTo(LayeredLayout::compact(_fullLayout, visible, getDpi() / GraphLayout::DOT_DEFAULT_DPI));
+	_compacted = true;
+}
+
+void Graph::animateTo(const GraphLayout& layout)
+{
+	if (_animation.state() == QTimeLine::Running) {
+		_animation.stop();
+		animationStep(1);
+	}
+
+	// the nodes are moved at once, and shifted back to where they were,
+	// the edges are hidden until the nodes are in place, this is done
+	// once the new geometry is ready
+	_animationOffsets.resize(_layout.nodes.size());
+	for (int v = 0 ; v < _layout.nodes.size() ; v++)
+		_animationOffsets[v] = _layout.nodes[v].center - layout.nodes[v].center;
+	_layout = layout;
+	// in the virtual scene, the items come and go, the elements are
+	// simply moved
+	_animationPending = !_virtualScene;
+	applyLayout();
+}
+
+void Graph::animationStep(qreal progress)
+{
+	for (unsigned int v = 0 ; v < _nodes.size() ; v++)
+		if (_nodes[v])
+			_nodes[v]->setPos(_animationOffsets[v] * (1 - progress));
+	for (unsigned int e = 0 ; e < _edges.size() ; e++)
+		if (_edges[e])
+			_edges[e]->setOpacity(progress);
+}
+
+int Graph::nearestNode(const QPointF& point) const
+{
+	int nearest = -1;
+	qreal distance = 0;
+	for (unsigned int v = 0 ; v < _nodes.size() ; v++) {
+		if (!_nodes[v] || !_nodes[v]->isVisible())
+			continue;
+		QPointF d = getNodeCenter(v) - point;
+		qreal dv = d.x() * d.x() + d.y() * d.y();
+		if (nearest < 0 || dv < distance) {
+			nearest = v;
+			distance = dv;
+		}
+	}
+	return nearest;
+}
+
+int Graph::nodeAt(const QPointF& point) const
+{
+	if (isAnimating()) {
+		// the items are on their way to the positions indexed
+		for (QGraphicsItem* item : items(point)) {
+			Node* node = dynamic_cast<Node*>(item);
+			if (node && node->isVisible() && node->_geometry.outline.contains(node->mapFromScene(point)))
+				return node->_index;
+		}
+		return -1;
+	}
+
+	QVector<int> found;
+	_nodeIndex.query(point, found);
+	for (int v : found) {
+		if (!_nodeHidden.testBit(v) && SceneGeometry::nodeContains(_shownLayout.nodes[v], point))
+			return v;
+	}
+	return -1;
+}
+
+void Graph::setHoveredNode(int v)
+{
+	if (v == _hoveredNode)
+		return;
+	_hoverTimer.stop();
+	if (_hoverApplied)
+		highlightReachable(_hoveredNode, false);
+	_hoveredNode = v;
+	_hoverApplied = false;
+	if (v >= 0)
+		_hoverTimer.start();
+}
+
+void Graph::hoverDwelled()
+{
+	if (_hoveredNode < 0 || _hoverApplied)
+		return;
+	QVector<int>* cached = _reachable.object(_hoveredNode);
+	if (cached) {
+		applyHover(*cached);
+		return;
+	}
+	// a search cannot be interrupted, the one in progress is followed
+	// by this one, if the node is still hovered then
+	if (_reachableWatcher.isRunning())
+		return;
+	_reachableJob = _hoveredNode;
+	// the data is copied, the styles of the elements may change in the
+	// meantime but the structure does not
+	_reachableWatcher.setFuture(QtConcurrent::run(&Graph::computeReachable, _data, _hoveredNode));
+}
+
+void Graph::reachableComputed()
+{
+	// the set is kept even if the node is not hovered any more, it
+	// will be ready if the mouse pointer comes back
+	QVector<int> ranges = _reachableWatcher.result();
+	_reachable.insert(_reachableJob, new QVector<int>(ranges), ranges.size());
+	if (_hoveredNode < 0 || _hoverTimer.isActive() || _hoverApplied)
+		return;
+	// the set is applied as it is, the cache drops those too big for it
+	if (_reachableJob == _hoveredNode)
+		applyHover(ranges);
+	else
+		hoverDwelled();
+}
+
+void Graph::applyHover(const QVector<int>& reachable)
+{
+	_hoverApplied = true;
+	highlightRanges(reachable, true);
+	int line = _data.getNodeLine(_hoveredNode);
+	QString file = _data.getNodeFile(_hoveredNode);
+	if (line && !file.isEmpty())
+		highlightLineInSourceCode(line, file);
+}
+
+void Graph::mouseMoveEvent(QGraphicsSceneMouseEvent* event)
+{
+	QGraphicsScene::mouseMoveEvent(event);
+	// the view scrolls while a button is held
+	if (event->buttons() == Qt::NoButton)
+		setHoveredNode(nodeAt(event->scenePos()));
+}
+
+void Graph::mousePressEvent(QGraphicsSceneMouseEvent* event)
+{
+	if (event->button() == Qt::LeftButton && event->modifiers() == Qt::ControlModifier) {
+		int v = nodeAt(event->scenePos());
+		if (v >= 0 && !_data.getNodeUrl(v).isEmpty()) {
+			callOtherGraph(_data.getNodeUrl(v));
+			return;
+		}
+	}
+	QGraphicsScene::mousePressEvent(event);
+}
+
+void Graph::mouseDoubleClickEvent(QGraphicsSceneMouseEvent* event)
+{
+	int v = nodeAt(event->scenePos());
+	if (v < 0) {
+		QGraphicsScene::mouseDoubleClickEvent(event);
+		return;
+	}
+	pimpSubTree(v, &Element::hide, &Node::isVisible, true);
+	highlightReachable(v, false);
+	// the node is gone from under the mouse pointer
+	if (v == _hoveredNode) {
+		_hoverTimer.stop();
+		_hoveredNode = -1;
+		_hoverApplied = false;
+	}
+}
+
+QPointF Graph::getNodeCenter(int node) const
+{
+	// where the node is displayed, the layout may be ahead of the items
+	if (_nodes[node])
+		return _nodes[node]->sceneBoundingRect().center();
+	return _layout.nodes[node].center;
+}
+
+void Graph::layoutFailed(const QString& error)
+{
+	_job = nullptr;
+	if (_coarseLayout) {
+		_coarseLayout = false; // the coarse layout stays
+		qWarning() << "Couldn't refine the layout of" << _filename << ":" << error;
+		return;
+	}
+	qWarning() << "Couldn't lay out" << _filename << ":" << error;
+	emit graphFailed(error);
 }
 
 QString Graph::getFilename() const
@@ -203,37 +849,217 @@ QString Graph::getFilename() const
 	return _filename;
 }
 
-void Graph::addNode(Agnode_t* v)
+void Graph::addNode(int v, const NodeGeometry& geometry)
 {
-	_nodes.emplace_back(new Node(v,this));
-	Node* node = _nodes.back().get();
+	if (_spareNodes.empty()) {
+		_nodes[v].reset(new Node(v,geometry,this));
+	} else {
+		_nodes[v] = std::move(_spareNodes.back());
+		_spareNodes.pop_back();
+		_nodes[v]->assign(v, geometry);
+	}
+	// the node may have been hidden or highlighted before having an item
+	Node* node = _nodes[v].get();
+	node->setVisible(!_nodeHidden.testBit(v));
+	if (_nodeHighlighted.testBit(v))
+		node->highlight();
+	else
+		node->unhighlight();
 	addItem(node);
-	setNode(v,node);
 }
 
-void Graph::addEdge(Agedge_t* e)
+void Graph::addEdge(int e, const EdgeGeometry& geometry)
 {
-	_edges.emplace_back(new Edge(e,this));
-	Edge* edge = _edges.back().get();
+	if (_spareEdges.empty()) {
+		_edges[e].reset(new Edge(e,geometry,this));
+	} else {
+		_edges[e] = std::move(_spareEdges.back());
+		_spareEdges.pop_back();
+		_edges[e]->assign(e, geometry);
+	}
+	Edge* edge = _edges[e].get();
+	edge->setVisible(!_edgeHidden.testBit(e));
+	if (_edgeHighlighted.testBit(e))
+		edge->highlight();
+	else
+		edge->unhighlight();
 	addItem(edge);
-	setEdge(e,edge);
 }
 
-bool Graph::hasHighlightedAncestor(const Node* n)
+void Graph::removeNode(int v)
 {
-	bool ancestorHighlighted = false;
-	for (Agedge_t* in = agfstin(_graph,n->_gv_node) ; in && !ancestorHighlighted ; in = agnxtin(_graph,in)) {
-		ancestorHighlighted = getEdge(in)->isHighlighted();
+	_nodeHighlighted.setBit(v, _nodes[v]->isHighlighted());
+	removeItem(_nodes[v].get());
+	_spareNodes.push_back(std::move(_nodes[v]));
+}
+
+void Graph::removeEdge(int e)
+{
+	_edgeHighlighted.setBit(e, _edges[e]->isHighlighted());
+	removeItem(_edges[e].get());
+	_spareEdges.push_back(std::move(_edges[e]));
+}
+
+void Graph::indexGeometry()
+{
+	_shownLayout = _geometryLayout;
+	QVector<QRectF> rects(_geometry.nodes.size());
+	for (int v = 0 ; v < rects.size() ; v++) {
+		const NodeGeometry& node = _geometry.nodes[v];
+		rects[v] = node.outline.boundingRect() | node.labelRect;
 	}
-	return ancestorHighlighted;
+	_nodeIndex.build(rects, _geometry.sceneRect);
+
+	rects.resize(_geometry.edges.size());
+	for (int e = 0 ; e < rects.size() ; e++) {
+		const EdgeGeometry& edge = _geometry.edges[e];
+		rects[e] = edge.path.boundingRect() | edge.arrowHead.boundingRect() | edge.labelRect;
+	}
+	_edgeIndex.build(rects, _geometry.sceneRect);
+}
+
+bool Graph::isVirtual() const
+{
+	return _virtualScene;
+}
+
+bool Graph::isAnimating() const
+{
+	return _animationPending || _animation.state() == QTimeLine::Running;
+}
+
+const GraphLayout& Graph::getLayout() const
+{
+	return _shownLayout;
+}
+
+const QSizeF& Graph::getCharSize() const
+{
+	return _charSize;
+}
+
+const GridIndex& Graph::getNodeIndex() const
+{
+	return _nodeIndex;
+}
+
+const GridIndex& Graph::getEdgeIndex() const
+{
+	return _edgeIndex;
+}
+
+void Graph::getStates(QBitArray& hiddenNodes, QBitArray& highlightedNodes,
+					  QBitArray& hiddenEdges, QBitArray& highlightedEdges) const
+{
+	hiddenNodes = _nodeHidden;
+	highlightedNodes = _nodeHighlighted;
+	for (unsigned int v = 0 ; v < _nodes.size() ; v++) {
+		if (_nodes[v])
+			highlightedNodes.setBit(v, _nodes[v]->isHighlighted());
+	}
+	hiddenEdges = _edgeHidden;
+	highlightedEdges = _edgeHighlighted;
+	for (unsigned int e = 0 ; e < _edges.size() ; e++) {
+		if (_edges[e])
+			highlightedEdges.setBit(e, _edges[e]->isHighlighted());
+	}
+}
+
+void Graph::setVisibleRegion(const QRectF& view)
+{
+	_visibleRegion = view;
+	if (!_virtualScene || view.isEmpty())
+		return;
+	// the items are kept while the view stays in the region covered, as
+	// long as it is not much bigger than needed
+	if (_materialized.contains(view) && _materialized.width() <= 4 * view.width())
+		return;
+
+	// half a view of margin in every direction, so that the items are
+	// ready before they come into view
+	QRectF region = view.adjusted(-view.width() / 2, -view.height() / 2,
+								  view.width() / 2, view.height() / 2);
+	int kept = 0;
+	for (int i = 0 ; i < _liveNodes.size() ; i++) {
+		int v = _liveNodes[i];
+		if (_nodeIndex.getRect(v).intersects(region))
+			_liveNodes[kept++] = v;
+		else
+			removeNode(v);
+	}
+	_liveNodes.resize(kept);
+	kept = 0;
+	for (int i = 0 ; i < _liveEdges.size() ; i++) {
+		int e = _liveEdges[i];
+		if (_edgeIndex.getRect(e).intersects(region))
+			_liveEdges[kept++] = e;
+		else
+			removeEdge(e);
+	}
+	_liveEdges.resize(kept);
+
+	// the geometry of the new items is computed from the layout, there
+	// are only a few hundreds of them at a time
+	QVector<int> found;
+	_nodeIndex.query(region, found);
+	for (int v : found) {
+		if (!_nodes[v]) {
+			addNode(v, SceneGeometry::computeNode(_shownLayout.nodes[v], _charSize));
+			_liveNodes.append(v);
+		}
+	}
+	found.clear();
+	_edgeIndex.query(region, found);
+	for (int e : found) {
+		if (!_edges[e]) {
+			addEdge(e, SceneGeometry::computeEdge(_shownLayout.edges[e], _charSize));
+			_liveEdges.append(e);
+		}
+	}
+	_materialized = region;
+}
+
+void Graph::setInitialView(const QRectF& view)
+{
+	_initialView = view;
+}
+
+bool Graph::isBuilding() const
+{
+	return _building;
+}
+
+qreal Graph::getLabelDetailThreshold() const
+{
+	return _labelDetailThreshold;
+}
+
+qreal Graph::getShapeDetailThreshold() const
+{
+	return _shapeDetailThreshold;
+}
+
+bool Graph::hasHighlightedAncestor(const Node* n)
+{
+	return hasHighlightedInEdge(n->_index);
 }
 
 bool Graph::hasHighlightedAncestor(const Edge* e)
 {
-	return hasHighlightedAncestor(getNode(agtail(e->_gv_edge)));
+	return hasHighlightedInEdge(_data.getEdgeTail(e->_index));
 }
 
-void Graph::callOtherGraph(QString url)
+bool Graph::hasHighlightedInEdge(int v) const
+{
+	bool ancestorHighlighted = false;
+	for (int i = _data.getInEdgesBegin(v) ; i < _data.getInEdgesEnd(v) && !ancestorHighlighted ; i++) {
+		int in = _data.getInEdge(i);
+		ancestorHighlighted = _edges[in] ? _edges[in]->isHighlighted() : _edgeHighlighted.testBit(in);
+	}
+	return ancestorHighlighted;
+}
+
+QString Graph::resolveUrl(const QString& url) const
 {
 	//Here, we have to tweak the URL
 	// Two cases: 1) the URL references a local (static) function, in this case, it will not have
@@ -243,14 +1069,20 @@ void Graph::callOtherGraph(QString url)
 
 	if (url.startsWith("./") && url.count("/") == 1) {
 		// Case 1)
-		url = QFileInfo(_filename).absolutePath() +	"/" + url + ".dot";
+		return QFileInfo(_filename).absolutePath() + "/" + url + ".dot";
 	} else {
 		// Case 2)
 		QSettings settings;
-		url = settings.value("diagrams dir").toString() + url + ".dot";
+		return settings.value("diagrams dir").toString() + url + ".dot";
 	}
+}
 
-	HyperlinkActivatedEvent hyperlink(_id, url);
+void Graph::callOtherGraph(QString url)
+{
+	url = resolveUrl(url);
+	// the diagram may be in the store rather than in a file of its own
+	QString diagram = DiagramStore::instance().canonicalPath(url);
+	HyperlinkActivatedEvent hyperlink(_id, diagram.isEmpty() ? url : diagram);
 	//qDebug() << "new Hyperlink event " << &hyperlink;
 	QList<QWidget*> topLevels = qApp->topLevelWidgets();
 	for (int i=0 ; i<topLevels.size() ; i++)
@@ -269,15 +1101,43 @@ void Graph::highlightLineInSourceCode(int line, QString& file)
 
 void Graph::reset()
 {
-	for (Agnode_t* v = agfstnode(_graph) ; v ; v = agnxtnode(_graph,v)) {
-		agsafeset(v, "style", "normal", "normal");
-		getNode(v)->setVisible(true);
-		getNode(v)->unhighlight();
-		for (Agedge_t* e = agfstout(_graph,v) ; e ; e = agnxtout(_graph,e)) {
-			agsafeset(e, "style", "normal", "normal");
-			getEdge(e)->setVisible(true);
-			getEdge(e)->unhighlight();
+	// only the elements hidden or highlighted since the last reset
+	// need to be restored
+	QVector<QRectF> areas;
+	for (int v : _touchedNodes) {
+		_nodeHidden.clearBit(v);
+		_nodeHighlighted.clearBit(v);
+		_nodeTouched.clearBit(v);
+		if (_nodes[v]) {
+			_nodes[v]->setVisible(true);
+			_nodes[v]->unhighlight();
 		}
+		areas.append(_nodeIndex.getRect(v));
+	}
+	for (int e : _touchedEdges) {
+		_edgeHidden.clearBit(e);
+		_edgeHighlighted.clearBit(e);
+		_edgeTouched.clearBit(e);
+		if (_edges[e]) {
+			_edges[e]->setVisible(true);
+			_edges[e]->unhighlight();
+		}
+		areas.append(_edgeIndex.getRect(e));
+	}
+	_touchedNodes.clear();
+	_touchedEdges.clear();
+	// the node hovered, if any, is not highlighted any more, it is
+	// hovered again on the next move of the mouse pointer
+	_hoverTimer.stop();
+	_hoveredNode = -1;
+	_hoverApplied = false;
+	if (!areas.isEmpty())
+		emit elementsChanged(areas);
+
+	if (_compacted) {
+		_compacted = false;
+		animateTo(_fullLayout);
+		_fullLayout = GraphLayout();
 	}
 }
 
@@ -285,3 +1145,18 @@ qint64 Graph::getId() const
 {
 	return _id;
 }
+
+qint64 Graph::getStageTime(Stage stage) const
+{
+	return _stageTimes[stage];
+}
+
+bool Graph::isLayoutFromCache() const
+{
+	return _layoutFromCache;
+}
+
+bool Graph::isLayoutCoarse() const
+{
+	return _coarseLayout;
+}
@@ -9,33 +9,75 @@
 
 #include <QObject>
 #include <QGraphicsScene>
-#include <gvc.h>
-#include <QGraphicsScene>
 #include <QPair>
 #include <QFont>
-#include <QMutex>
+#include <QFile>
+#include <QByteArray>
+#include <QVector>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QBitArray>
+#include <QCache>
+#include <QTimeLine>
+#include <QTimer>
+#include <QFutureWatcher>
+#include <QSizeF>
 #include <functional>
 #include <vector>
 #include <memory>
+#include "graphlayout.h"
+#include "scenegeometry.h"
+#include "gridindex.h"
+#include "diagramdata.h"
 
 class Node;
 class Edge;
 class Element;
+class LayoutJob;
 
 /**
  * \brief This class is responsible for displaying a diagram from a file in dot
  * format.
  *
  * A Graph is a graphics scene populated with the element of the diagram.
- * The diagram is parsed from a file using the GraphViz library. The layout of
- * the nodes and edges is computed by GraphViz's dot and the result is displayed
- * by this class.
+ * The diagram is read by the DotReader from a file, mapped in memory, or from
+ * the DiagramStore. The layout of the nodes and edges is computed by
+ * GraphViz's dot, in a worker process managed by the LayoutScheduler, and the
+ * result is displayed by this class.
+ *
+ * Diagrams with a very large number of elements are displayed in a virtual
+ * scene: the items of the scene are created only for the elements around
+ * the part of the diagram shown by the view (see setVisibleRegion()), and
+ * recycled as the view moves. The state of the elements without an item is
+ * kept aside.
  */
 class Graph : public QGraphicsScene
 {
 	Q_OBJECT
 
 public:
+	/**
+	 * \brief The successive stages of the construction of a diagram.
+	 */
+	enum Stage {
+		/**
+		 * \brief the reading and parsing of the diagram file
+		 */
+		PARSE_STAGE = 0,
+		/**
+		 * \brief the layout of the diagram by GraphViz
+		 */
+		LAYOUT_STAGE,
+		/**
+		 * \brief the creation of the items of the scene
+		 */
+		BUILD_STAGE,
+		/**
+		 * \brief the number of stages
+		 */
+		STAGE_COUNT
+	};
+
 	/**
 	 * \brief Constructor. Loads a GraphViz file and builds the diagram
 	 * from there.
@@ -52,27 +94,30 @@ public:
 	Graph(quint64 id, const QString& filename, QObject* parent = nullptr);
 
 	/**
-	 * \brief Destroys the diagram and frees associated GraphViz resources.
+	 * \brief Destroys the diagram.
+	 *
+	 * If the diagram is still being laid out, the layout is cancelled.
 	 */
 	~Graph();
 	/**
 	 * \brief Conditionally applies a function to all nodes and edges
-	 * accessible from node \p n.
+	 * accessible from node \p v.
 	 *
 	 * The name subTree can be misleading because it is not required that
 	 * the entire diagram be a tree or even an acyclic graph. Still, this
 	 * function may give better results on acyclic graphs, depending on \p
 	 * f.
 	 *
-	 * \param n the node from which the transformation is applied
+	 * \param v the index of the node from which the transformation is
+	 * applied
 	 * \param f the function to apply to each nodes and edges accessible
-	 * from n
+	 * from v
 	 * \param test a predicate to decide whether to apply the function on
 	 * an eligible node or edge
 	 * \param incomingEdgesAreConcerned whether the transformation should
-	 * also be applied on edge coming to \p n
+	 * also be applied on edge coming to \p v
 	 */
-	void pimpSubTree(Node *n, std::function<void (Element &)> f, std::function<bool (Element&)> test = nullptr, bool incomingEdgesAreConcerned =  false);
+	void pimpSubTree(int v, std::function<void (Element &)> f, std::function<bool (Element&)> test = nullptr, bool incomingEdgesAreConcerned =  false);
 	/**
 	 * \brief Conditionally applies a function to all nodes and edges
 	 * accessible from edge \p e.
@@ -90,23 +135,17 @@ public:
 	 */
 	void pimpSubTree(Edge *e, std::function<void (Element &)> f, std::function<bool (Element&)> test = nullptr);
 
-	/**
-	 * \brief the dots-per-inch value used by dot in its layout information
-	 */
-	static const qreal DOT_DEFAULT_DPI;
 	/**
 	 * \brief a monospace font to use for all labels in the diagram
 	 */
 	static const QFont MONOSPACE_FONT;
 
 	/**
-	 * \brief Gets a pointer to the GraphViz structure representing the
-	 * diagram.
+	 * \brief Gets the structure and attributes of the diagram.
 	 *
-	 * \return a pointer to the GraphViz structure representing the
-	 * diagram
+	 * \return the diagram as read from its file
 	 */
-	const Agraph_t* getAgraph() const;
+	const DiagramData& getData() const;
 	/**
 	 * \brief Gets the DPI resolution used for the graph
 	 *
@@ -139,6 +178,15 @@ public:
 	 * URL attribute in an element of the Graph)
 	 */
 	void callOtherGraph(QString url);
+	/**
+	 * \brief Gives the file of the diagram a URL of this diagram points
+	 * to.
+	 *
+	 * \param url the value of the attribute "URL" of a node
+	 *
+	 * \return the path of the diagram file, which may not exist
+	 */
+	QString resolveUrl(const QString& url) const;
 
 	/**
 	 * \brief Gives the name of the file from which the diagram is extracted.
@@ -157,87 +205,925 @@ public:
 	 */
 	qint64 getId() const;
 
+	/**
+	 * \brief Gives the time spent in a stage of the construction of the
+	 * diagram.
+	 *
+	 * \param stage the stage of interest
+	 *
+	 * \return the duration of the stage in milliseconds, or -1 if the
+	 * stage is not finished
+	 */
+	qint64 getStageTime(Stage stage) const;
+	/**
+	 * \brief Tells whether the layout of the diagram was found in the
+	 * layout cache.
+	 *
+	 * \return true if, and only if, the layout was not computed
+	 */
+	bool isLayoutFromCache() const;
+	/**
+	 * \brief Tells whether the diagram is displayed with a coarse layout
+	 * while GraphViz computes the real one.
+	 *
+	 * \return true if, and only if, the layout is to be refined
+	 */
+	bool isLayoutCoarse() const;
+	/**
+	 * \brief Finds the visible node closest to a point.
+	 *
+	 * \param point a point, in scene coordinates
+	 *
+	 * \return the index of the node, or -1 if there is no visible node
+	 */
+	int nearestNode(const QPointF& point) const;
+	/**
+	 * \brief Finds the visible node under a point.
+	 *
+	 * The candidates are found from the index of the nodes, and the point
+	 * is tested against their exact outline, as displayed. While the nodes
+	 * are animated, the items of the scene are tested instead.
+	 *
+	 * \param point a point, in scene coordinates
+	 *
+	 * \return the index of the node, or -1 if there is none
+	 */
+	int nodeAt(const QPointF& point) const;
+	/**
+	 * \brief Highlights the elements reachable from the node under the
+	 * mouse pointer, and shows its line in the source code.
+	 *
+	 * The elements highlighted from the node hovered before are
+	 * unhighlighted at once. The new node is only highlighted once the
+	 * mouse pointer has stayed on it for a while, see hoverDwelled(),
+	 * so that nothing is done for the nodes merely crossed.
+	 *
+	 * \param v the index of the node hovered, or -1 if the mouse pointer
+	 * is not over a node
+	 */
+	void setHoveredNode(int v);
+	/**
+	 * \brief Records that a node is hidden.
+	 *
+	 * This is called by Node::hide(), which hides the item of the node.
+	 *
+	 * \param v the index of the node
+	 */
+	void markNodeHidden(int v);
+	/**
+	 * \brief Records that an edge is hidden.
+	 *
+	 * This is called by Edge::hide(), which hides the item of the edge.
+	 *
+	 * \param e the index of the edge
+	 */
+	void markEdgeHidden(int e);
+	/**
+	 * \brief Tells whether a node is hidden.
+	 *
+	 * \param v the index of the node
+	 *
+	 * \return true if, and only if, the node is hidden
+	 */
+	bool isNodeHidden(int v) const;
+	/**
+	 * \brief Tells whether an edge is hidden.
+	 *
+	 * \param e the index of the edge
+	 *
+	 * \return true if, and only if, the edge is hidden
+	 */
+	bool isEdgeHidden(int e) const;
+	/**
+	 * \brief Highlights or unhighlights all nodes and edges accessible
+	 * from a node.
+	 *
+	 * This does the same as pimpSubTree() with Element::highlight() or
+	 * Element::unhighlight(), but the flags of the elements are changed
+	 * directly, from the set given by reachableFrom(), and the scene is
+	 * updated once, over the area of the elements which have changed.
+	 *
+	 * \param v the index of the node
+	 * \param highlighted whether the elements are highlighted
+	 */
+	void highlightReachable(int v, bool highlighted);
+	/**
+	 * \brief Gives the position of a node.
+	 *
+	 * \param node the index of the node
+	 *
+	 * \return the center of the node, in scene coordinates
+	 */
+	QPointF getNodeCenter(int node) const;
+	/**
+	 * \brief Sets the part of the diagram to build first, because it is
+	 * the first one shown.
+	 *
+	 * This is meant to be called by a slot connected to signal
+	 * aboutToBuild(), by default the whole diagram is considered shown.
+	 *
+	 * \param view the part of the scene shown first
+	 */
+	void setInitialView(const QRectF& view);
+	/**
+	 * \brief Tells whether the elements of the diagram are still being
+	 * created.
+	 *
+	 * While the diagram is being built, the operations on the elements
+	 * (highlighting, hiding, etc.) keep the state of the elements not
+	 * built yet aside, and they take it when they are built.
+	 *
+	 * \return true if, and only if, some elements are not built yet
+	 */
+	bool isBuilding() const;
+	/**
+	 * \brief Gives the level of detail under which the labels of the
+	 * elements are not drawn.
+	 *
+	 * The level of detail is the scale at which the diagram is shown. The
+	 * threshold is read from setting "label detail threshold".
+	 *
+	 * \return the minimum level of detail at which the labels are drawn
+	 */
+	qreal getLabelDetailThreshold() const;
+	/**
+	 * \brief Gives the level of detail under which the elements are drawn
+	 * in a simplified way: nodes as filled rectangles and edges as
+	 * polylines without arrow heads.
+	 *
+	 * The threshold is read from setting "shape detail threshold".
+	 *
+	 * \return the minimum level of detail at which the elements are drawn
+	 * exactly
+	 */
+	qreal getShapeDetailThreshold() const;
+	/**
+	 * \brief Tells whether the scene only contains the elements around
+	 * the part of the diagram shown.
+	 *
+	 * The scene is virtual if the diagram has more elements than setting
+	 * "virtual scene threshold".
+	 *
+	 * \return true if, and only if, the scene is virtual
+	 */
+	bool isVirtual() const;
+	/**
+	 * \brief Tells which part of the diagram is shown, so that the
+	 * elements in and around it have an item in the scene.
+	 *
+	 * The items of the elements far from it are removed from the scene
+	 * and recycled. Nothing is done if the scene is not virtual, or if
+	 * the items around \p view are there already.
+	 *
+	 * \param view the part of the scene shown by the view
+	 */
+	void setVisibleRegion(const QRectF& view);
+	/**
+	 * \brief Tells whether the nodes are moving to a new layout.
+	 *
+	 * \return true if, and only if, an animation is running or about to
+	 * start
+	 */
+	bool isAnimating() const;
+	/**
+	 * \brief Gives the layout of the elements displayed.
+	 *
+	 * This is the layout matching the indexes given by getNodeIndex() and
+	 * getEdgeIndex(), a new layout is only used once its geometry is
+	 * computed.
+	 *
+	 * \return the layout
+	 */
+	const GraphLayout& getLayout() const;
+	/**
+	 * \brief Gives the size of a character of the labels.
+	 *
+	 * \return the width of a character and the height of a line of text
+	 * in the monospace font
+	 */
+	const QSizeF& getCharSize() const;
+	/**
+	 * \brief Gives the index of the bounding rectangles of the nodes.
+	 *
+	 * \return the index of the nodes, empty until the diagram is built
+	 */
+	const GridIndex& getNodeIndex() const;
+	/**
+	 * \brief Gives the index of the bounding rectangles of the edges.
+	 *
+	 * \return the index of the edges, empty until the diagram is built
+	 */
+	const GridIndex& getEdgeIndex() const;
+	/**
+	 * \brief Gives the state of all the elements, whether they have an
+	 * item or not.
+	 *
+	 * \param hiddenNodes filled with whether each node is hidden
+	 * \param highlightedNodes filled with whether each node is highlighted
+	 * \param hiddenEdges filled with whether each edge is hidden
+	 * \param highlightedEdges filled with whether each edge is highlighted
+	 */
+	void getStates(QBitArray& hiddenNodes, QBitArray& highlightedNodes,
+				   QBitArray& hiddenEdges, QBitArray& highlightedEdges) const;
+
+	/**
+	 * \brief the maximum time spent building elements before letting
+	 * the event loop run, in milliseconds
+	 */
+	static const int BUILD_SLICE = 10;
+	/**
+	 * \brief the default level of detail under which labels are not
+	 * drawn, the text being only a few pixels high
+	 */
+	static const qreal DEFAULT_LABEL_DETAIL_THRESHOLD;
+	/**
+	 * \brief the default level of detail under which the elements are
+	 * simplified
+	 */
+	static const qreal DEFAULT_SHAPE_DETAIL_THRESHOLD;
+	/**
+	 * \brief the default number of elements above which the scene is
+	 * virtual
+	 */
+	static const int DEFAULT_VIRTUAL_SCENE_THRESHOLD = 50000;
+	/**
+	 * \brief the number of items above which the scene is indexed by a
+	 * BSP tree, when the setting "scene index" is "automatic"
+	 */
+	static const int BSP_INDEX_THRESHOLD = 2000;
+	/**
+	 * \brief the number of integers used by the sets of nodes reachable
+	 * from the nodes hovered, at most
+	 */
+	static const int REACHABLE_CACHE_SIZE = 1 << 20;
+	/**
+	 * \brief the default time the mouse pointer must stay on a node for
+	 * it to be highlighted, in milliseconds
+	 */
+	static const int DEFAULT_HOVER_DELAY = 80;
+
 public slots:
 	/**
 	 * \brief Restores the diagram to its initial state, with all the
 	 * elements visible.
+	 *
+	 * If the diagram has been compacted, the elements move back to their
+	 * original positions.
 	 */
 	void reset();
+	/**
+	 * \brief Moves the visible elements closer, to fill the holes left by
+	 * the hidden ones.
+	 *
+	 * The ranks and the order of the nodes computed by GraphViz are kept,
+	 * only the empty space is removed (see LayeredLayout::compact()), and
+	 * the nodes are animated to their new positions.
+	 */
+	void compact();
 	void build();
+	/**
+	 * \brief Aborts the construction of the diagram, if it is not
+	 * finished.
+	 *
+	 * The signal graphFailed() is emitted if there was something to
+	 * abort.
+	 */
+	void cancel();
 
 	void highlightLineInSourceCode(int line, QString& file);
 
 signals:
+	/**
+	 * \brief This signal is emitted when the part of the diagram shown
+	 * first is built, the rest of the diagram is built progressively.
+	 */
 	void graphBuilt();
+	/**
+	 * \brief This signal is emitted just before the elements of the
+	 * diagram are built, once the scene rectangle is known.
+	 *
+	 * A slot connected to this signal may call setInitialView().
+	 */
+	void aboutToBuild();
 	void layoutDone();
+	/**
+	 * \brief This signal is emitted when some elements have been
+	 * highlighted, unhighlighted, hidden or shown.
+	 *
+	 * \param areas the bounding rectangles of the elements concerned, in
+	 * scene coordinates
+	 */
+	void elementsChanged(const QVector<QRectF>& areas);
+	/**
+	 * \brief This signal is emitted just before the elements of the
+	 * diagram move to a new layout.
+	 */
+	void layoutAboutToChange();
+	/**
+	 * \brief This signal is emitted when the elements of the diagram
+	 * have moved to a new layout.
+	 */
+	void layoutChanged();
+	/**
+	 * \brief This signal is emitted when the diagram cannot be displayed.
+	 *
+	 * \param error the reason of the failure
+	 */
+	void graphFailed(const QString& error);
+	/**
+	 * \brief This signal is emitted when a stage of the construction of
+	 * the diagram begins.
+	 *
+	 * The parsing stage takes place in the constructor and is over when
+	 * build() is called, this signal is not emitted for it.
+	 *
+	 * \param stage the Stage beginning
+	 */
+	void stageStarted(int stage);
+	/**
+	 * \brief This signal is emitted when a stage of the construction of
+	 * the diagram is over.
+	 *
+	 * \param stage the Stage which has ended
+	 * \param milliseconds the duration of the stage
+	 */
+	void stageFinished(int stage, qint64 milliseconds);
+
+protected:
+	/**
+	 * \brief Updates the node hovered.
+	 *
+	 * The nodes do not accept hover events, the node under the mouse
+	 * pointer is found by nodeAt().
+	 *
+	 * \param event the mouse event
+	 */
+	virtual void mouseMoveEvent(QGraphicsSceneMouseEvent* event) override;
+	/**
+	 * \brief Activates the hyperlink of the node under the mouse pointer
+	 * if the user holds key Ctrl.
+	 *
+	 * \param event the mouse event
+	 */
+	virtual void mousePressEvent(QGraphicsSceneMouseEvent* event) override;
+	/**
+	 * \brief Hides the node under the mouse pointer and all the elements
+	 * reachable only from it.
+	 *
+	 * \param event the mouse event
+	 */
+	virtual void mouseDoubleClickEvent(QGraphicsSceneMouseEvent* event) override;
 
 private slots:
 	/**
-	 * \brief When this slots is triggered, the Graph asks GraphViz to do
-	 * the layout of the diagram.
+	 * \brief When this slots is triggered, the layout computed by
+	 * GraphViz is available and the Graph takes it from the layout job.
+	 */
+	void layoutFinished();
+	/**
+	 * \brief When this slots is triggered, the diagram could not be laid
+	 * out.
+	 *
+	 * \param error the reason of the failure
+	 */
+	void layoutFailed(const QString& error);
+	/**
+	 * \brief When this slot is triggered, a layout worker has started
+	 * laying out the diagram.
+	 */
+	void layoutStarted();
+	/**
+	 * \brief Moves the elements of the diagram to the current layout.
+	 *
+	 * The elements move once their new geometry has been computed in the
+	 * background.
+	 */
+	void applyLayout();
+	/**
+	 * \brief When this slot is triggered, the geometry of the elements
+	 * has been computed in the background, and the elements can be built
+	 * or moved.
+	 */
+	void geometryComputed();
+	/**
+	 * \brief Moves the nodes one step closer to their new positions, and
+	 * fades the edges in.
+	 *
+	 * \param progress the progress of the animation, between 0 and 1
+	 */
+	void animationStep(qreal progress);
+	/**
+	 * \brief Starts building the elements of the diagram, those in the
+	 * initial view first.
 	 */
-	void doLayout();
 	void doBuild();
+	/**
+	 * \brief Builds elements for a while, and schedules the next slice
+	 * if there are elements left.
+	 */
+	void buildSlice();
+	/**
+	 * \brief When this slot is triggered, the mouse pointer has stayed
+	 * on the same node long enough for it to be highlighted.
+	 *
+	 * The nodes reachable from the node are searched for in the
+	 * background if they are not known yet.
+	 */
+	void hoverDwelled();
+	/**
+	 * \brief When this slot is triggered, the nodes reachable from a node
+	 * have been found in the background.
+	 *
+	 * The set is cached, and applied if the node is still hovered.
+	 */
+	void reachableComputed();
 
 private:
 	/**
 	 * \brief Adds a node to the Graph.
 	 *
-	 * \param v the GraphViz node to add
+	 * The item of the node is recycled from a removed node if possible,
+	 * and takes the state of the node.
+	 *
+	 * \param v the index of the node in the diagram
+	 * \param geometry the shapes of the node
 	 */
-	void addNode(Agnode_t* v);
+	void addNode(int v, const NodeGeometry& geometry);
 	/**
 	 * \brief Adds an edge to the Graph.
 	 *
-	 * \param v the GraphViz edge to add
+	 * The item of the edge is recycled from a removed edge if possible,
+	 * and takes the state of the edge.
+	 *
+	 * \param e the index of the edge in the diagram
+	 * \param geometry the shapes of the edge
 	 */
-	void addEdge(Agedge_t* v);
-
+	void addEdge(int e, const EdgeGeometry& geometry);
 	/**
-	 * \brief Sets some of the diagram's attributes to default values.
+	 * \brief Removes the item of a node from the scene, keeping its state
+	 * aside, and keeps the item for recycling.
 	 *
-	 * This must be done before any laying out takes place.
+	 * \param v the index of the node in the diagram
 	 */
-	void setAttrs();
+	void removeNode(int v);
+	/**
+	 * \brief Removes the item of an edge from the scene, keeping its
+	 * state aside, and keeps the item for recycling.
+	 *
+	 * \param e the index of the edge in the diagram
+	 */
+	void removeEdge(int e);
+	/**
+	 * \brief Gives an item standing for a node without item.
+	 *
+	 * The item is not in the scene, it is shared by all the nodes and
+	 * only has the state of node \p v until the next call.
+	 *
+	 * \param v the index of the node in the diagram
+	 *
+	 * \return the detached item, bound to node \p v
+	 */
+	Node& detachedNode(int v);
+	/**
+	 * \brief Gives an item standing for an edge without item.
+	 *
+	 * \param e the index of the edge in the diagram
+	 *
+	 * \return the detached item, bound to edge \p e
+	 */
+	Edge& detachedEdge(int e);
+	/**
+	 * \brief Applies a function to a node, whether it has an item or
+	 * not.
+	 *
+	 * \param v the index of the node in the diagram
+	 * \param f the function to apply
+	 */
+	void applyToNode(int v, const std::function<void (Element&)>& f);
+	/**
+	 * \brief Applies a function to an edge, whether it has an item or
+	 * not.
+	 *
+	 * \param e the index of the edge in the diagram
+	 * \param f the function to apply
+	 */
+	void applyToEdge(int e, const std::function<void (Element&)>& f);
+	/**
+	 * \brief Applies a predicate to a node, whether it has an item or
+	 * not.
+	 *
+	 * \param v the index of the node in the diagram
+	 * \param test the predicate
+	 *
+	 * \return the result of \p test
+	 */
+	bool testNode(int v, const std::function<bool (Element&)>& test);
+	/**
+	 * \brief Conditionally applies a function to all nodes and edges
+	 * accessible from a node, see pimpSubTree().
+	 *
+	 * \param v the index of the node from which the transformation is
+	 * applied
+	 * \param f the function to apply to each nodes and edges accessible
+	 * from \p v
+	 * \param test a predicate to decide whether to apply the function on
+	 * an eligible node or edge
+	 * \param incomingEdgesAreConcerned whether the transformation should
+	 * also be applied on edge coming to \p v
+	 */
+	void pimpSubTreeFrom(int v, const std::function<void (Element &)>& f, const std::function<bool (Element&)>& test, bool incomingEdgesAreConcerned);
+	/**
+	 * \brief Gives the nodes reachable from a node.
+	 *
+	 * The set is computed the first time it is needed and kept in @a
+	 * _reachable. It only depends on the structure of the diagram, which
+	 * does not change.
+	 *
+	 * \param v the index of the node
+	 *
+	 * \return the nodes reachable from \p v, including it, as a sorted
+	 * list of ranges of indices: the first node of a range is followed by
+	 * the index following its last node
+	 */
+	QVector<int> reachableFrom(int v);
+	/**
+	 * \brief Finds the nodes reachable from a node.
+	 *
+	 * This function only reads the structure of the diagram and can be
+	 * called from any thread, with a copy of the data.
+	 *
+	 * \param data the structure of the diagram
+	 * \param v the index of the node
+	 *
+	 * \return the nodes reachable from \p v, as for reachableFrom()
+	 */
+	static QVector<int> computeReachable(const DiagramData& data, int v);
+	/**
+	 * \brief Highlights or unhighlights the nodes of a set, and their
+	 * outgoing edges, as highlightReachable() does.
+	 *
+	 * \param ranges the nodes, as given by reachableFrom()
+	 * \param highlighted whether the elements are highlighted
+	 */
+	void highlightRanges(const QVector<int>& ranges, bool highlighted);
+	/**
+	 * \brief Highlights the elements reachable from the node hovered,
+	 * and shows its line in the source code.
+	 *
+	 * \param reachable the nodes reachable from the node hovered, as
+	 * given by reachableFrom()
+	 */
+	void applyHover(const QVector<int>& reachable);
+	/**
+	 * \brief Sets the highlight flag of a node, without repainting it.
+	 *
+	 * \param v the index of the node
+	 * \param highlighted whether the node is highlighted
+	 *
+	 * \return true if, and only if, the flag has changed
+	 */
+	bool setNodeHighlighted(int v, bool highlighted);
+	/**
+	 * \brief Sets the highlight flag of an edge, without repainting it.
+	 *
+	 * \param e the index of the edge
+	 * \param highlighted whether the edge is highlighted
+	 *
+	 * \return true if, and only if, the flag has changed
+	 */
+	bool setEdgeHighlighted(int e, bool highlighted);
+	/**
+	 * \brief Adds a node to the elements restored by reset(), if it is
+	 * not there yet.
+	 *
+	 * \param v the index of the node
+	 */
+	void touchNode(int v);
+	/**
+	 * \brief Adds an edge to the elements restored by reset(), if it is
+	 * not there yet.
+	 *
+	 * \param e the index of the edge
+	 */
+	void touchEdge(int e);
+	/**
+	 * \brief Tells whether an edge coming to a node is highlighted.
+	 *
+	 * \param v the index of the node in the diagram
+	 *
+	 * \return true if, and only if, at least one edge coming to \p v is
+	 * highlighted
+	 */
+	bool hasHighlightedInEdge(int v) const;
+	/**
+	 * \brief Indexes the bounding rectangles of the elements in the
+	 * geometry just computed, whose layout becomes the one displayed.
+	 */
+	void indexGeometry();
+	/**
+	 * \brief Ends the construction of the diagram, once all the elements
+	 * are built, or indexed for the virtual scene.
+	 */
+	void buildDone();
+	/**
+	 * \brief Reads and parses the diagram, from the diagram store if it is
+	 * there, from its file otherwise.
+	 *
+	 * \throw std::runtime_error if the file does not exist or is not
+	 * a GraphViz file
+	 */
+	void readFile();
+	/**
+	 * \brief Releases the text of the diagram, once it has been handed
+	 * over to the layout scheduler.
+	 */
+	void releaseDot();
+	/**
+	 * \brief Ends the layout stage and starts building the diagram.
+	 */
+	void layoutReady();
+	/**
+	 * \brief Starts computing the geometry of the elements for the
+	 * current layout, in the background.
+	 *
+	 * geometryComputed() is triggered when it is done.
+	 */
+	void computeGeometry();
+	/**
+	 * \brief Moves the existing elements to the geometry just computed.
+	 */
+	void applyGeometry();
+	/**
+	 * \brief Moves the elements of the diagram to a new layout, with an
+	 * animation.
+	 *
+	 * \param layout the new layout
+	 */
+	void animateTo(const GraphLayout& layout);
+
 	/**
 	 * \brief the diagram identifier
 	 */
 	quint64 _id = 0;
 	/**
-	 * \brief the context for GraphViz
+	 * \brief the diagram file, mapped in memory until the layout is
+	 * submitted
+	 */
+	QFile _file;
+	/**
+	 * \brief the text of the diagram, in dot format, not a copy of
+	 * the file content if it could be mapped in memory
+	 */
+	QByteArray _dot;
+	/**
+	 * \brief the address of the file content mapped in memory, if any
+	 */
+	uchar* _mapped = nullptr;
+	/**
+	 * \brief the structure and attributes of the diagram
+	 */
+	DiagramData _data;
+	/**
+	 * \brief the layout job in progress, if any
+	 */
+	QPointer<LayoutJob> _job;
+	/**
+	 * \brief the geometry of the diagram, once laid out
 	 */
-	GVC_t* _gv_con;
+	GraphLayout _layout;
 	/**
-	 * \brief the GraphViz graph
+	 * \brief the layout from which the geometry in @a _geometryWatcher
+	 * is computed
 	 */
-	Agraph_t* _graph;
+	GraphLayout _geometryLayout;
 	/**
-	 * \brief the resolution DPI asked for
+	 * \brief the layout of the elements displayed, from which @a
+	 * _nodeIndex and @a _edgeIndex are built, which lags behind @a
+	 * _layout while the new geometry is computed
 	 */
-	qreal _dpi;
+	GraphLayout _shownLayout;
+	/**
+	 * \brief whether the layout was found in the layout cache
+	 */
+	bool _layoutFromCache = false;
+	/**
+	 * \brief whether the layout came along with the diagram, from the
+	 * Prefetcher or from the DiagramStore
+	 */
+	bool _laidOut = false;
+	/**
+	 * \brief whether the current layout is a coarse one, waiting for the
+	 * layout computed by GraphViz
+	 */
+	bool _coarseLayout = false;
+	/**
+	 * \brief the layout computed for the whole diagram, while the current
+	 * layout is a compacted one
+	 */
+	GraphLayout _fullLayout;
+	/**
+	 * \brief whether the current layout is a compacted one
+	 */
+	bool _compacted = false;
+	/**
+	 * \brief the animation of the nodes toward a new layout
+	 */
+	QTimeLine _animation;
+	/**
+	 * \brief the offset of each node from its new position at the
+	 * beginning of the animation
+	 */
+	QVector<QPointF> _animationOffsets;
+	/**
+	 * \brief whether the animation is to start once the geometry of the
+	 * new layout is computed
+	 */
+	bool _animationPending = false;
+	/**
+	 * \brief the computation of the geometry of the elements in the
+	 * background
+	 */
+	QFutureWatcher<SceneGeometry> _geometryWatcher;
+	/**
+	 * \brief the geometry of the elements, while they are built or moved
+	 */
+	SceneGeometry _geometry;
+	/**
+	 * \brief the width of a character and the height of a line of text
+	 * in the monospace font
+	 */
+	QSizeF _charSize;
+	/**
+	 * \brief the level of detail under which labels are not drawn
+	 */
+	qreal _labelDetailThreshold;
+	/**
+	 * \brief the level of detail under which the elements are simplified
+	 */
+	qreal _shapeDetailThreshold;
+	/**
+	 * \brief the part of the diagram shown first
+	 */
+	QRectF _initialView;
+	/**
+	 * \brief the nodes in the order in which they are built, those in
+	 * the initial view first
+	 */
+	QVector<int> _buildOrder;
+	/**
+	 * \brief the position in @a _buildOrder of the next node to build
+	 */
+	int _buildNext = 0;
+	/**
+	 * \brief the number of nodes in the initial view
+	 */
+	int _initialCount = 0;
+	/**
+	 * \brief whether the elements are being built
+	 */
+	bool _building = false;
+	/**
+	 * \brief whether only the elements around the view have an item
+	 */
+	bool _virtualScene = false;
+	/**
+	 * \brief the index of the bounding rectangles of the nodes
+	 */
+	GridIndex _nodeIndex;
+	/**
+	 * \brief the node under the mouse pointer, -1 if there is none
+	 */
+	int _hoveredNode = -1;
+	/**
+	 * \brief whether the elements reachable from @a _hoveredNode are
+	 * highlighted
+	 */
+	bool _hoverApplied = false;
+	/**
+	 * \brief the timer started when a node is hovered
+	 */
+	QTimer _hoverTimer;
+	/**
+	 * \brief the search for reachable nodes in progress
+	 */
+	QFutureWatcher<QVector<int>> _reachableWatcher;
+	/**
+	 * \brief the node from which the search in progress started
+	 */
+	int _reachableJob = -1;
+	/**
+	 * \brief the nodes reachable from the nodes already hovered, see
+	 * reachableFrom(), the cost of a set being the number of integers
+	 * used to store it
+	 */
+	QCache<int, QVector<int>> _reachable;
+	/**
+	 * \brief the index of the bounding rectangles of the edges
+	 */
+	GridIndex _edgeIndex;
+	/**
+	 * \brief the bounding rectangles of the elements changed by the
+	 * operation in progress
+	 */
+	QVector<QRectF> _changedAreas;
+	/**
+	 * \brief the part of the diagram shown by the view, in the virtual
+	 * scene
+	 */
+	QRectF _visibleRegion;
+	/**
+	 * \brief the part of the diagram whose elements have an item, in the
+	 * virtual scene
+	 */
+	QRectF _materialized;
+	/**
+	 * \brief the nodes having an item, in the virtual scene
+	 */
+	QVector<int> _liveNodes;
+	/**
+	 * \brief the edges having an item, in the virtual scene
+	 */
+	QVector<int> _liveEdges;
+	/**
+	 * \brief whether each node is highlighted, meaningful for the nodes
+	 * without an item only
+	 */
+	QBitArray _nodeHighlighted;
+	/**
+	 * \brief whether each edge is highlighted, meaningful for the edges
+	 * without an item only
+	 */
+	QBitArray _edgeHighlighted;
+	/**
+	 * \brief whether each node is hidden
+	 */
+	QBitArray _nodeHidden;
+	/**
+	 * \brief whether each edge is hidden
+	 */
+	QBitArray _edgeHidden;
+	/**
+	 * \brief the nodes hidden or highlighted since the last reset, which
+	 * are the only ones reset() has to restore
+	 */
+	QVector<int> _touchedNodes;
+	/**
+	 * \brief the edges hidden or highlighted since the last reset
+	 */
+	QVector<int> _touchedEdges;
+	/**
+	 * \brief whether each node is in @a _touchedNodes
+	 */
+	QBitArray _nodeTouched;
+	/**
+	 * \brief whether each edge is in @a _touchedEdges
+	 */
+	QBitArray _edgeTouched;
+	/**
+	 * \brief the duration of each stage, -1 for the stages not finished
+	 */
+	qint64 _stageTimes[STAGE_COUNT];
+	/**
+	 * \brief the time elapsed since the beginning of the current stage
+	 */
+	QElapsedTimer _stageTimer;
 	/**
 	 * \brief the file (in GraphViz format) from which the diagram is read
 	 */
 	QString _filename;
-	QString _sourceFilename;
-	int _sourceLineNumber;
-
-	static QMutex _graphviz;
 
 	/**
-	 * @brief contains pointers to nodes for deallocation
+	 * @brief contains pointers to nodes for deallocation, indexed like
+	 * the nodes of the diagram, null for the nodes without an item
 	 *
 	 * Nodes are not default-constructible, nor copy-constructible,
 	 * therefore, we can only store pointers to them.
 	 */
 	std::vector<std::unique_ptr<Node>> _nodes;
 	/**
-	 * @brief contains pointers to edges for deallocation
+	 * @brief contains pointers to edges for deallocation, indexed like
+	 * the edges of the diagram, null for the edges without an item
 	 *
 	 * Edges are not default-constructible, nor copy-constructible,
 	 * therefore, we can only store pointers to them.
 	 */
 	std::vector<std::unique_ptr<Edge>> _edges;
+	/**
+	 * @brief the items removed from the scene, to be recycled
+	 */
+	std::vector<std::unique_ptr<Node>> _spareNodes;
+	/**
+	 * @brief the items removed from the scene, to be recycled
+	 */
+	std::vector<std::unique_ptr<Edge>> _spareEdges;
+	/**
+	 * @brief the item standing for the nodes without an item
+	 */
+	std::unique_ptr<Node> _detachedNode;
+	/**
+	 * @brief the item standing for the edges without an item
+	 */
+	std::unique_ptr<Edge> _detachedEdge;
 
 };
 
@@ -9,6 +9,7 @@
 #include <QRegExp>
 #include <QStringList>
 #include <QDebug>
+#include "diagramstore.h"
 #include "graph.h"
 
 constexpr const char* const GraphItem::COLUMNS[];
@@ -20,7 +21,7 @@ GraphItem::GraphItem(const Graph& graph, quint64 id, GraphItem *parent) : GraphI
 GraphItem::GraphItem(const QFileInfo& graph, quint64 id, GraphItem *parent) : _id(id), _parent(parent)
 {
 	QSettings settings;
-	QString realPath(graph.canonicalFilePath());
+	QString realPath(DiagramStore::instance().canonicalPath(graph.filePath()));
 	QString prefixPath(settings.value("diagrams dir").toString());
 
 	QRegExp extractor(QRegExp::escape(prefixPath) + "(.*\\/)(.*\\.c)\\/(.*)\\.");
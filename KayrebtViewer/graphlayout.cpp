@@ -0,0 +1,145 @@
+/**
+ * @file graphlayout.cpp
+ * @brief Implementation of class GraphLayout
+ */
+#include <stdexcept>
+#include <QString>
+#include <types.h>
+#include "graphlayout.h"
+
+const qreal GraphLayout::DOT_DEFAULT_DPI = 72.0;
+const qreal GraphLayout::DEFAULT_DPI = 96.0;
+const char* const GraphLayout::FONT_FAMILY = "Monospace";
+
+namespace {
+	/**
+	 * @brief Sets some of the diagram's attributes to default values.
+	 *
+	 * This must be done before any laying out takes place.
+	 */
+	void setAttrs(Agraph_t* g, qreal dpi)
+	{
+		agattr(g, AGNODE, const_cast<char*>("fontname"), const_cast<char*>(GraphLayout::FONT_FAMILY));
+		agattr(g, AGNODE, const_cast<char*>("fontsize"), const_cast<char*>(qPrintable(QString("%1").arg(GraphLayout::FONT_POINT_SIZE*GraphLayout::DOT_DEFAULT_DPI/dpi))));
+	}
+
+	inline QPointF toScene(const pointf& p, const Agraph_t* g, qreal scale)
+	{
+		return QPointF(p.x*scale, (GD_bb(g).UR.y - p.y)*scale);
+	}
+}
+
+qreal GraphLayout::dpiOf(Agraph_t* g)
+{
+	// cannot access through GD_drawing(g)->_dpi as the layout may not be done yet
+	qreal dpi = QString(agget(g, const_cast<char*>("dpi"))).toDouble();
+	if (dpi == 0)
+		dpi = DEFAULT_DPI;
+	return dpi;
+}
+
+GraphLayout GraphLayout::compute(const QByteArray& dot, GVC_t* gvc)
+{
+	Agraph_t* g = agmemread(const_cast<char*>(dot.constData()));
+	if (!g)
+		throw std::runtime_error("Couldn't parse graph from input file");
+
+	qreal dpi = dpiOf(g);
+	setAttrs(g, dpi);
+	if (gvLayout(gvc, g, "dot") != 0) {
+		agclose(g);
+		throw std::runtime_error("Couldn't lay out graph");
+	}
+
+	GraphLayout layout = fromAgraph(g, dpi);
+	gvFreeLayout(gvc, g);
+	agclose(g);
+	return layout;
+}
+
+GraphLayout GraphLayout::fromAgraph(Agraph_t* g, qreal dpi)
+{
+	GraphLayout layout;
+	qreal scale = dpi/DOT_DEFAULT_DPI;
+
+	layout.boundingBox = QRectF(QPointF(GD_bb(g).LL.x*scale, 0),
+								QPointF(GD_bb(g).UR.x*scale, (GD_bb(g).UR.y - GD_bb(g).LL.y)*scale));
+
+	for (Agnode_t* v = agfstnode(g) ; v ; v = agnxtnode(g,v)) {
+		NodeLayout node;
+		node.center = toScene(ND_coord(v), g, scale);
+		node.size = QSizeF(ND_width(v)*dpi, ND_height(v)*dpi);
+		node.shape = ND_shape(v)->name;
+		if (ND_label(v))
+			node.label = ND_label(v)->text;
+		layout.nodes.append(node);
+
+		for (Agedge_t* e = agfstout(g,v) ; e ; e = agnxtout(g,e)) {
+			EdgeLayout edge;
+			// Only one spline, as the graph is strict. If it weren't,
+			// we would have to iterate over the first list too.
+			if (ED_spl(e) && ED_spl(e)->list != 0) {
+				const bezier* bz = ED_spl(e)->list;
+				edge.spline.reserve(bz->size);
+				for (int i=0 ; i<bz->size ; i++)
+					edge.spline.append(toScene(bz->list[i], g, scale));
+				edge.hasStart = bz->sflag;
+				if (edge.hasStart)
+					edge.start = toScene(bz->sp, g, scale);
+				edge.hasEnd = bz->eflag;
+				if (edge.hasEnd)
+					edge.end = toScene(bz->ep, g, scale);
+			}
+			if (ED_label(e)) {
+				edge.label = ED_label(e)->text;
+				edge.labelPos = QPointF(ED_label(e)->pos.x*scale - ED_label(e)->dimen.x*scale/2,
+										(GD_bb(g).UR.y - ED_label(e)->pos.y)*scale);
+			}
+			layout.edges.append(edge);
+		}
+	}
+
+	return layout;
+}
+
+QDataStream& operator<<(QDataStream& out, const NodeLayout& node)
+{
+	return out << node.center << node.size << node.shape << node.label;
+}
+
+QDataStream& operator>>(QDataStream& in, NodeLayout& node)
+{
+	return in >> node.center >> node.size >> node.shape >> node.label;
+}
+
+QDataStream& operator<<(QDataStream& out, const EdgeLayout& edge)
+{
+	out << edge.spline << edge.hasStart;
+	if (edge.hasStart)
+		out << edge.start;
+	out << edge.hasEnd;
+	if (edge.hasEnd)
+		out << edge.end;
+	return out << edge.label << edge.labelPos;
+}
+
+QDataStream& operator>>(QDataStream& in, EdgeLayout& edge)
+{
+	in >> edge.spline >> edge.hasStart;
+	if (edge.hasStart)
+		in >> edge.start;
+	in >> edge.hasEnd;
+	if (edge.hasEnd)
+		in >> edge.end;
+	return in >> edge.label >> edge.labelPos;
+}
+
+QDataStream& operator<<(QDataStream& out, const GraphLayout& layout)
+{
+	return out << layout.boundingBox << layout.nodes << layout.edges;
+}
+
+QDataStream& operator>>(QDataStream& in, GraphLayout& layout)
+{
+	return in >> layout.boundingBox >> layout.nodes >> layout.edges;
+}
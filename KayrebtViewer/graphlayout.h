@@ -0,0 +1,177 @@
+/**
+ * @file graphlayout.h
+ * @brief Definition of class GraphLayout
+ */
+#ifndef GRAPHLAYOUT_H
+#define GRAPHLAYOUT_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QPointF>
+#include <QRectF>
+#include <QSizeF>
+#include <QString>
+#include <QVector>
+#include <gvc.h>
+
+/**
+ * @brief The geometry of a node, as computed by GraphViz.
+ *
+ * All coordinates are expressed in the diagram scene coordinates, i.e. they
+ * are already scaled to the diagram resolution and the y-axis is pointing
+ * downwards.
+ */
+struct NodeLayout
+{
+	/**
+	 * @brief the center of the node
+	 */
+	QPointF center;
+	/**
+	 * @brief the width and height of the node shape
+	 */
+	QSizeF size;
+	/**
+	 * @brief the name of the GraphViz shape of the node ("rect",
+	 * "diamond", "ellipse", etc.)
+	 */
+	QString shape;
+	/**
+	 * @brief the text of the node, possibly empty
+	 */
+	QString label;
+};
+
+/**
+ * @brief The geometry of an edge, as computed by GraphViz.
+ *
+ * All coordinates are expressed in the diagram scene coordinates, i.e. they
+ * are already scaled to the diagram resolution and the y-axis is pointing
+ * downwards.
+ */
+struct EdgeLayout
+{
+	/**
+	 * @brief the control points of the edge spline, the first one being
+	 * followed by as many groups of three points as there are cubic
+	 * segments in the spline
+	 */
+	QVector<QPointF> spline;
+	/**
+	 * @brief whether the spline has a starting point distinct from its
+	 * first control point
+	 */
+	bool hasStart = false;
+	/**
+	 * @brief the starting point of the spline, if @a hasStart is true
+	 */
+	QPointF start;
+	/**
+	 * @brief whether the spline has an ending point distinct from its
+	 * last control point
+	 */
+	bool hasEnd = false;
+	/**
+	 * @brief the ending point of the spline, if @a hasEnd is true
+	 */
+	QPointF end;
+	/**
+	 * @brief the text of the edge, possibly empty
+	 */
+	QString label;
+	/**
+	 * @brief the position of the top-left corner of the label
+	 */
+	QPointF labelPos;
+};
+
+/**
+ * @brief This class holds the complete geometry of a diagram laid out by
+ * GraphViz, in a form which does not depend on GraphViz data structures.
+ *
+ * Nodes are stored in the order in which GraphViz iterates over them
+ * (agfstnode()/agnxtnode()) and edges in the order of their tail node, then in
+ * the order of agfstout()/agnxtout(). Two GraphViz graphs parsed from the same
+ * text can therefore be matched element by element with a GraphLayout.
+ *
+ * A GraphLayout can be serialized with QDataStream, this is how it is sent
+ * back from the layout worker processes.
+ */
+class GraphLayout
+{
+public:
+	/**
+	 * @brief the dots-per-inch value used by dot in its layout information
+	 */
+	static const qreal DOT_DEFAULT_DPI;
+	/**
+	 * @brief the dots-per-inch value used for diagrams which do not set the
+	 * graph attribute "dpi"
+	 */
+	static const qreal DEFAULT_DPI;
+	/**
+	 * @brief the family of the font used for all labels in the diagram
+	 */
+	static const char* const FONT_FAMILY;
+	/**
+	 * @brief the size, in points, of the font used for all labels in the
+	 * diagram
+	 */
+	static const int FONT_POINT_SIZE = 15;
+
+	/**
+	 * @brief Parses a diagram and lays it out with GraphViz's dot.
+	 *
+	 * This function must never be called from several threads at the
+	 * same time, GraphViz layout engines are not reentrant.
+	 *
+	 * \throw std::runtime_error if the text is not a GraphViz graph
+	 *
+	 * @param dot the diagram, in dot format
+	 * @param gvc the GraphViz context to use
+	 *
+	 * @return the layout of the diagram
+	 */
+	static GraphLayout compute(const QByteArray& dot, GVC_t* gvc);
+	/**
+	 * @brief Extracts the layout information of an already laid out
+	 * GraphViz graph.
+	 *
+	 * @param g the GraphViz graph
+	 * @param dpi the resolution of the diagram
+	 *
+	 * @return the layout of the diagram
+	 */
+	static GraphLayout fromAgraph(Agraph_t* g, qreal dpi);
+	/**
+	 * @brief Gets the resolution asked for by a diagram.
+	 *
+	 * @param g the GraphViz graph
+	 *
+	 * @return the value of attribute "dpi" of graph @p g, or a sensible
+	 * default value if it has none
+	 */
+	static qreal dpiOf(Agraph_t* g);
+
+	/**
+	 * @brief the bounding box of the diagram
+	 */
+	QRectF boundingBox;
+	/**
+	 * @brief the geometry of the nodes
+	 */
+	QVector<NodeLayout> nodes;
+	/**
+	 * @brief the geometry of the edges
+	 */
+	QVector<EdgeLayout> edges;
+};
+
+QDataStream& operator<<(QDataStream& out, const NodeLayout& node);
+QDataStream& operator>>(QDataStream& in, NodeLayout& node);
+QDataStream& operator<<(QDataStream& out, const EdgeLayout& edge);
+QDataStream& operator>>(QDataStream& in, EdgeLayout& edge);
+QDataStream& operator<<(QDataStream& out, const GraphLayout& layout);
+QDataStream& operator>>(QDataStream& in, GraphLayout& layout);
+
+#endif // GRAPHLAYOUT_H
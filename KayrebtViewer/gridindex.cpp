@@ -0,0 +1,105 @@
+/**
+ * @file gridindex.cpp
+ * @brief Implementation of class GridIndex
+ */
+#include <qmath.h>
+#include "gridindex.h"
+
+void GridIndex::build(const QVector<QRectF>& rects, const QRectF& bounds)
+{
+	clear();
+	_rects = rects;
+	_bounds = bounds;
+	for (const QRectF& rect : rects)
+		_bounds |= rect;
+	if (rects.isEmpty() || _bounds.isEmpty())
+		return;
+
+	// about four rectangles per cell, if they were evenly spread
+	_cellSize = 2 * qSqrt(_bounds.width() * _bounds.height() / rects.size());
+	_cellSize = qMax(_cellSize, qMax(_bounds.width(), _bounds.height()) / MAX_CELLS);
+	_columns = qMin(MAX_CELLS, int(_bounds.width() / _cellSize) + 1);
+	_rows = qMin(MAX_CELLS, int(_bounds.height() / _cellSize) + 1);
+
+	// count the rectangles in each cell, then place them
+	_cellStart.fill(0, _columns * _rows + 1);
+	for (const QRectF& rect : rects)
+		for (int r = row(rect.top()) ; r <= row(rect.bottom()) ; r++)
+			for (int c = column(rect.left()) ; c <= column(rect.right()) ; c++)
+				_cellStart[r * _columns + c + 1]++;
+	for (int cell = 0 ; cell < _columns * _rows ; cell++)
+		_cellStart[cell + 1] += _cellStart[cell];
+
+	_cells.resize(_cellStart.last());
+	QVector<int> next(_cellStart);
+	for (int i = 0 ; i < rects.size() ; i++) {
+		const QRectF& rect = rects[i];
+		for (int r = row(rect.top()) ; r <= row(rect.bottom()) ; r++)
+			for (int c = column(rect.left()) ; c <= column(rect.right()) ; c++)
+				_cells[next[r * _columns + c]++] = i;
+	}
+	_marks.fill(0, rects.size());
+}
+
+void GridIndex::clear()
+{
+	_rects.clear();
+	_cellStart.clear();
+	_cells.clear();
+	_marks.clear();
+	_mark = 0;
+	_columns = 0;
+	_rows = 0;
+}
+
+void GridIndex::query(const QRectF& area, QVector<int>& result) const
+{
+	if (_columns == 0 || !area.intersects(_bounds))
+		return;
+
+	if (++_mark == 0) { // wrapped around, forget everything
+		_marks.fill(0);
+		_mark = 1;
+	}
+	for (int r = row(area.top()) ; r <= row(area.bottom()) ; r++) {
+		for (int c = column(area.left()) ; c <= column(area.right()) ; c++) {
+			int cell = r * _columns + c;
+			for (int k = _cellStart[cell] ; k < _cellStart[cell + 1] ; k++) {
+				int i = _cells[k];
+				if (_marks[i] != _mark && _rects[i].intersects(area)) {
+					_marks[i] = _mark;
+					result.append(i);
+				}
+			}
+		}
+	}
+}
+
+const QRectF& GridIndex::getRect(int i) const
+{
+	return _rects[i];
+}
+
+void GridIndex::query(const QPointF& point, QVector<int>& result) const
+{
+	if (_columns == 0 || !_bounds.contains(point))
+		return;
+
+	// a rectangle is listed once per cell, no need to mark it
+	int cell = row(point.y()) * _columns + column(point.x());
+	for (int k = _cellStart[cell] ; k < _cellStart[cell + 1] ; k++) {
+		int i = _cells[k];
+		if (_rects[i].contains(point))
+			result.append(i);
+	}
+}
+
+int GridIndex::column(qreal x) const
+{
+	return qBound(0, int((x - _bounds.left()) / _cellSize), _columns - 1);
+}
+
+int GridIndex::row(qreal y) const
+{
+	return qBound(0, int((y - _bounds.top()) / _cellSize), _rows - 1);
+}
@@ -0,0 +1,130 @@
+/**
+ * @file gridindex.h
+ * @brief Definition of class GridIndex
+ */
+#ifndef GRIDINDEX_H
+#define GRIDINDEX_H
+
+#include <QPointF>
+#include <QRectF>
+#include <QVector>
+
+/**
+ * @brief This class finds quickly the rectangles, out of a fixed set, which
+ * intersect a given area.
+ *
+ * The bounding rectangle of the set is cut in a uniform grid of cells, and
+ * each cell lists the rectangles overlapping it, all the lists being stored
+ * contiguously. A query only looks at the cells overlapping the area of
+ * interest. The index is built at once and is not modified afterwards.
+ */
+class GridIndex
+{
+public:
+	/**
+	 * @brief Builds the index of a set of rectangles.
+	 *
+	 * The size of the cells is chosen so that a cell contains a few
+	 * rectangles on average.
+	 *
+	 * @param rects the rectangles, identified by their position in the
+	 * vector
+	 * @param bounds a rectangle containing all the others
+	 */
+	void build(const QVector<QRectF>& rects, const QRectF& bounds);
+	/**
+	 * @brief Empties the index.
+	 */
+	void clear();
+	/**
+	 * @brief Finds the rectangles which intersect an area.
+	 *
+	 * @param area the area of interest
+	 * @param result the vector to which the position of the rectangles
+	 * found is appended, each rectangle appearing once
+	 */
+	void query(const QRectF& area, QVector<int>& result) const;
+	/**
+	 * @brief Finds the rectangles which contain a point.
+	 *
+	 * Only the cell of the point is looked at, this is what hit-testing
+	 * the position of the mouse needs.
+	 *
+	 * @param point the point of interest
+	 * @param result the vector to which the position of the rectangles
+	 * found is appended
+	 */
+	void query(const QPointF& point, QVector<int>& result) const;
+	/**
+	 * @brief Gives one of the rectangles indexed.
+	 *
+	 * @param i the position of the rectangle
+	 *
+	 * @return the rectangle
+	 */
+	const QRectF& getRect(int i) const;
+
+	/**
+	 * @brief the maximum number of columns and rows of the grid
+	 */
+	static const int MAX_CELLS = 1024;
+
+private:
+	/**
+	 * @brief Gives the column of the grid containing an abscissa.
+	 *
+	 * @param x the abscissa
+	 *
+	 * @return the column, clamped to the grid
+	 */
+	int column(qreal x) const;
+	/**
+	 * @brief Gives the row of the grid containing an ordinate.
+	 *
+	 * @param y the ordinate
+	 *
+	 * @return the row, clamped to the grid
+	 */
+	int row(qreal y) const;
+
+	/**
+	 * @brief the area covered by the grid
+	 */
+	QRectF _bounds;
+	/**
+	 * @brief the width and height of a cell
+	 */
+	qreal _cellSize = 1;
+	/**
+	 * @brief the number of columns of the grid
+	 */
+	int _columns = 0;
+	/**
+	 * @brief the number of rows of the grid
+	 */
+	int _rows = 0;
+	/**
+	 * @brief the rectangles indexed
+	 */
+	QVector<QRectF> _rects;
+	/**
+	 * @brief for each cell, the position in @a _cells of the first
+	 * rectangle it contains, plus a last element marking the end
+	 */
+	QVector<int> _cellStart;
+	/**
+	 * @brief the rectangles contained in each cell, cell after cell
+	 */
+	QVector<int> _cells;
+	/**
+	 * @brief for each rectangle, the number of the last query which found
+	 * it, so that it is reported once
+	 */
+	mutable QVector<quint32> _marks;
+	/**
+	 * @brief the number of the last query
+	 */
+	mutable quint32 _mark = 0;
+};
+
+#endif // GRIDINDEX_H
@@ -0,0 +1,33 @@
+/**
+ * @file labelcache.cpp
+ * @brief Implementation of class LabelCache
+ */
+#include <QThreadStorage>
+#include <QTransform>
+#include "labelcache.h"
+#include "graph.h"
+
+LabelCache& LabelCache::local()
+{
+	static QThreadStorage<LabelCache*> caches;
+	if (!caches.hasLocalData())
+		caches.setLocalData(new LabelCache);
+	return *caches.localData();
+}
+
+LabelCache::LabelCache() :
+	_labels(MAX_LABELS)
+{
+}
+
+QStaticText LabelCache::get(const QString& text)
+{
+	QStaticText* label = _labels.object(text);
+	if (!label) {
+		label = new QStaticText(text);
+		label->setTextFormat(Qt::PlainText);
+		label->prepare(QTransform(), Graph::MONOSPACE_FONT);
+		_labels.insert(text, label);
+	}
+	return *label;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file labelcache.h
+ * @brief Definition of class LabelCache
+ */
+#ifndef LABELCACHE_H
+#define LABELCACHE_H
+
+#include <QCache>
+#include <QString>
+#include <QStaticText>
+
+/**
+ * @brief This class keeps the labels of the diagrams laid out, so that the
+ * many labels with the same text (`return`, `NULL`, the usual calls, etc.)
+ * share the same glyph layout and are not laid out each time they are
+ * painted.
+ *
+ * All the labels are written with Graph::MONOSPACE_FONT, the texts are the
+ * keys of the cache. QStaticText is not meant to be shared between threads,
+ * each thread painting labels has its own cache, which keeps the
+ * MAX_LABELS labels most recently used.
+ */
+class LabelCache
+{
+public:
+	/**
+	 * @brief Gives the cache of the calling thread, creating it if
+	 * necessary.
+	 *
+	 * @return the cache
+	 */
+	static LabelCache& local();
+	/**
+	 * @brief Gives a label laid out.
+	 *
+	 * @param text the text of the label, one line per line of text
+	 *
+	 * @return the label, ready to be drawn with
+	 * QPainter::drawStaticText() in the monospace font
+	 */
+	QStaticText get(const QString& text);
+
+	/**
+	 * @brief the maximum number of labels kept by each cache
+	 */
+	static const int MAX_LABELS = 10000;
+
+private:
+	/**
+	 * @brief Constructor.
+	 */
+	LabelCache();
+
+	/**
+	 * @brief the labels, by text
+	 */
+	QCache<QString,QStaticText> _labels;
+};
+
+#endif // LABELCACHE_H
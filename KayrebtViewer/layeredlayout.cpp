@@ -0,0 +1,337 @@
+/**
+ * @file layeredlayout.cpp
+ * @brief Implementation of class LayeredLayout
+ */
+#include <algorithm>
+#include <cmath>
+#include <QPair>
+#include <QStringList>
+#include <QtCore/qmath.h>
+#include "layeredlayout.h"
+
+namespace {
+	// dot's defaults, in points
+	const qreal RANK_SEPARATION = 36;
+	const qreal NODE_SEPARATION = 18;
+	const qreal MIN_NODE_WIDTH = 54;
+	const qreal MIN_NODE_HEIGHT = 36;
+	const qreal LABEL_MARGIN_X = 8;
+	const qreal LABEL_MARGIN_Y = 4;
+	const qreal GRAPH_MARGIN = 4;
+	const int ORDERING_PASSES = 2;
+}
+
+GraphLayout LayeredLayout::compute(const DiagramData& data, const QSizeF& charSize)
+{
+	qreal scale = data.getDpi() / GraphLayout::DOT_DEFAULT_DPI;
+
+	GraphLayout layout;
+	layout.nodes.reserve(data.getNodeCount());
+	for (int v = 0 ; v < data.getNodeCount() ; v++)
+		layout.nodes.append(shape(data, v, charSize, scale));
+
+	QVector<int> ranks = rank(data);
+	place(order(data, ranks), scale, layout);
+	route(data, scale, layout);
+	return layout;
+}
+
+GraphLayout LayeredLayout::compact(const GraphLayout& layout, const QVector<bool>& visible, qreal scale)
+{
+	// the visible nodes occupy bands, horizontally and vertically, the
+	// space between the bands is empty
+	QVector<QPair<qreal,qreal>> columns;
+	QVector<QPair<qreal,qreal>> rows;
+	for (int v = 0 ; v < layout.nodes.size() ; v++) {
+		if (!visible[v])
+			continue;
+		const NodeLayout& node = layout.nodes[v];
+		qreal w = node.size.width() / 2;
+		qreal h = node.size.height() / 2;
+		columns.append(qMakePair(node.center.x() - w, node.center.x() + w));
+		rows.append(qMakePair(node.center.y() - h, node.center.y() + h));
+	}
+	if (columns.isEmpty())
+		return layout;
+
+	Compression x(columns, NODE_SEPARATION * scale, GRAPH_MARGIN * scale);
+	Compression y(rows, RANK_SEPARATION * scale, GRAPH_MARGIN * scale);
+	auto map = [&x, &y](const QPointF& p) { return QPointF(x.map(p.x()), y.map(p.y())); };
+
+	GraphLayout compacted = layout;
+	for (NodeLayout& node : compacted.nodes)
+		node.center = map(node.center);
+	for (EdgeLayout& edge : compacted.edges) {
+		for (QPointF& p : edge.spline)
+			p = map(p);
+		edge.start = map(edge.start);
+		edge.end = map(edge.end);
+		edge.labelPos = map(edge.labelPos);
+	}
+	compacted.boundingBox = QRectF(0, 0, x.map(layout.boundingBox.right()), y.map(layout.boundingBox.bottom()));
+	return compacted;
+}
+
+LayeredLayout::Compression::Compression(QVector<QPair<qreal,qreal>> intervals, qreal separation, qreal margin) :
+	_separation(separation)
+{
+	std::sort(intervals.begin(), intervals.end());
+	for (const QPair<qreal,qreal>& i : intervals) {
+		// bands narrower than the separation are left as they are
+		if (!_intervals.isEmpty() && i.first <= _intervals.last().second + separation)
+			_intervals.last().second = qMax(_intervals.last().second, i.second);
+		else
+			_intervals.append(i);
+	}
+
+	qreal start = margin;
+	for (const QPair<qreal,qreal>& i : _intervals) {
+		_starts.append(start);
+		start += i.second - i.first + separation;
+	}
+}
+
+qreal LayeredLayout::Compression::map(qreal x) const
+{
+	if (_intervals.isEmpty())
+		return x;
+
+	// the last interval starting before x
+	int i = std::upper_bound(_intervals.begin(), _intervals.end(), qMakePair(x, qreal(HUGE_VAL))) - _intervals.begin() - 1;
+	if (i < 0)
+		return _starts[0] + x - _intervals[0].first;
+	if (x <= _intervals[i].second || i == _intervals.size() - 1)
+		return _starts[i] + x - _intervals[i].first;
+
+	// in an empty band, shrunk proportionally
+	qreal end = _intervals[i].second;
+	qreal band = _intervals[i + 1].first - end;
+	return _starts[i] + end - _intervals[i].first + (x - end) * _separation / band;
+}
+
+QVector<int> LayeredLayout::rank(const DiagramData& data)
+{
+	int nodes = data.getNodeCount();
+
+	// depth-first search, the edges going back to a node on the stack
+	// close a cycle and are ignored in the ranking
+	QVector<char> state(nodes, 0); // 0: not visited, 1: on the stack, 2: done
+	QVector<bool> backEdge(data.getEdgeCount(), false);
+	QVector<int> postorder;
+	postorder.reserve(nodes);
+	QVector<QPair<int,int>> stack; // node, next out-edge to follow
+	for (int root = 0 ; root < nodes ; root++) {
+		if (state[root])
+			continue;
+		state[root] = 1;
+		stack.append(qMakePair(root, data.getOutEdgesBegin(root)));
+		while (!stack.isEmpty()) {
+			int v = stack.last().first;
+			int e = stack.last().second;
+			if (e == data.getOutEdgesEnd(v)) {
+				state[v] = 2;
+				postorder.append(v);
+				stack.removeLast();
+				continue;
+			}
+			stack.last().second++;
+			int head = data.getEdgeHead(e);
+			if (state[head] == 1) {
+				backEdge[e] = true;
+			} else if (state[head] == 0) {
+				state[head] = 1;
+				stack.append(qMakePair(head, data.getOutEdgesBegin(head)));
+			}
+		}
+	}
+
+	// longest path from the sources, in topological order
+	QVector<int> ranks(nodes, 0);
+	for (int i = postorder.size() - 1 ; i >= 0 ; i--) {
+		int v = postorder[i];
+		for (int e = data.getOutEdgesBegin(v) ; e < data.getOutEdgesEnd(v) ; e++) {
+			int head = data.getEdgeHead(e);
+			if (!backEdge[e] && ranks[head] < ranks[v] + 1)
+				ranks[head] = ranks[v] + 1;
+		}
+	}
+	return ranks;
+}
+
+QVector<QVector<int>> LayeredLayout::order(const DiagramData& data, const QVector<int>& ranks)
+{
+	int nodes = data.getNodeCount();
+	int maxRank = 0;
+	for (int r : ranks)
+		maxRank = qMax(maxRank, r);
+
+	QVector<QVector<int>> layers(nodes ? maxRank + 1 : 0);
+	QVector<int> position(nodes);
+	for (int v = 0 ; v < nodes ; v++) {
+		position[v] = layers[ranks[v]].size();
+		layers[ranks[v]].append(v);
+	}
+
+	// barycenter heuristic, downward then upward
+	QVector<QPair<qreal,int>> sorted;
+	for (int pass = 0 ; pass < 2 * ORDERING_PASSES ; pass++) {
+		bool down = pass % 2 == 0;
+		for (int i = 1 ; i < layers.size() ; i++) {
+			QVector<int>& layer = layers[down ? i : layers.size() - 1 - i];
+			sorted.clear();
+			for (int v : layer) {
+				qreal sum = 0;
+				int count = 0;
+				if (down) {
+					for (int j = data.getInEdgesBegin(v) ; j < data.getInEdgesEnd(v) ; j++) {
+						int tail = data.getEdgeTail(data.getInEdge(j));
+						if (ranks[tail] < ranks[v]) {
+							sum += position[tail];
+							count++;
+						}
+					}
+				} else {
+					for (int e = data.getOutEdgesBegin(v) ; e < data.getOutEdgesEnd(v) ; e++) {
+						int head = data.getEdgeHead(e);
+						if (ranks[head] > ranks[v]) {
+							sum += position[head];
+							count++;
+						}
+					}
+				}
+				sorted.append(qMakePair(count ? sum / count : qreal(position[v]), v));
+			}
+			std::stable_sort(sorted.begin(), sorted.end(),
+					 [](const QPair<qreal,int>& a, const QPair<qreal,int>& b) { return a.first < b.first; });
+			for (int j = 0 ; j < sorted.size() ; j++) {
+				layer[j] = sorted[j].second;
+				position[layer[j]] = j;
+			}
+		}
+	}
+	return layers;
+}
+
+NodeLayout LayeredLayout::shape(const DiagramData& data, int node, const QSizeF& charSize, qreal scale)
+{
+	NodeLayout layout;
+	layout.shape = data.getNodeShape(node);
+	if (layout.shape.isEmpty())
+		layout.shape = "ellipse";
+	layout.label = data.getNodeLabel(node);
+	if (layout.label.isEmpty())
+		layout.label = "\\N";
+	layout.label.replace("\\N", data.getNodeName(node));
+
+	// the label lines are separated by \n, \l or \r (the last two
+	// justify the line, and may end the label)
+	QString text(layout.label);
+	text.replace("\\l", "\\n").replace("\\r", "\\n");
+	QStringList lines = text.split("\\n");
+	if (lines.size() > 1 && lines.last().isEmpty())
+		lines.removeLast();
+	int columns = 0;
+	for (const QString& line : lines)
+		columns = qMax(columns, line.size());
+
+	qreal width = columns * charSize.width() + 2 * LABEL_MARGIN_X * scale;
+	qreal height = lines.size() * charSize.height() + 2 * LABEL_MARGIN_Y * scale;
+	if (layout.shape == "diamond") {
+		width *= 2;
+		height *= 2;
+	} else if (layout.shape != "rect" && layout.shape != "box") {
+		width *= qSqrt(2);
+		height *= qSqrt(2);
+	}
+	layout.size = QSizeF(qMax(width, MIN_NODE_WIDTH * scale), qMax(height, MIN_NODE_HEIGHT * scale));
+	return layout;
+}
+
+void LayeredLayout::place(const QVector<QVector<int>>& layers, qreal scale, GraphLayout& layout)
+{
+	qreal top = 0;
+	qreal left = 0;
+	qreal right = 0;
+	for (const QVector<int>& layer : layers) {
+		qreal width = NODE_SEPARATION * scale * (layer.size() - 1);
+		qreal height = 0;
+		for (int v : layer) {
+			width += layout.nodes[v].size.width();
+			height = qMax(height, layout.nodes[v].size.height());
+		}
+
+		qreal x = -width / 2;
+		for (int v : layer) {
+			NodeLayout& node = layout.nodes[v];
+			node.center = QPointF(x + node.size.width() / 2, top + height / 2);
+			x += node.size.width() + NODE_SEPARATION * scale;
+		}
+		left = qMin(left, -width / 2);
+		right = qMax(right, width / 2);
+		top += height + RANK_SEPARATION * scale;
+	}
+
+	// the scene starts at the origin, as with GraphViz
+	qreal margin = GRAPH_MARGIN * scale;
+	QPointF shift(margin - left, margin);
+	for (NodeLayout& node : layout.nodes)
+		node.center += shift;
+	qreal height = layers.isEmpty() ? 0 : top - RANK_SEPARATION * scale;
+	layout.boundingBox = QRectF(0, 0, right - left + 2 * margin, height + 2 * margin);
+}
+
+void LayeredLayout::route(const DiagramData& data, qreal scale, GraphLayout& layout)
+{
+	layout.edges.resize(data.getEdgeCount());
+	for (int e = 0 ; e < data.getEdgeCount() ; e++) {
+		const NodeLayout& tail = layout.nodes[data.getEdgeTail(e)];
+		const NodeLayout& head = layout.nodes[data.getEdgeHead(e)];
+		EdgeLayout& edge = layout.edges[e];
+		edge.hasStart = false;
+		edge.hasEnd = false;
+		edge.spline.clear();
+
+		QPointF from, to;
+		if (data.getEdgeTail(e) == data.getEdgeHead(e)) {
+			// a loop on the right side of the node
+			qreal w = tail.size.width() / 2;
+			qreal h = tail.size.height() / 2;
+			from = tail.center + QPointF(w, -h / 3);
+			to = tail.center + QPointF(w, h / 3);
+			edge.spline << from
+				    << tail.center + QPointF(w + RANK_SEPARATION * scale / 2, -h)
+				    << tail.center + QPointF(w + RANK_SEPARATION * scale / 2, h)
+				    << to;
+		} else {
+			from = border(tail, head.center);
+			to = border(head, tail.center);
+			edge.spline << from
+				    << from + (to - from) / 3
+				    << from + 2 * (to - from) / 3
+				    << to;
+		}
+
+		edge.label = data.getEdgeLabel(e);
+		edge.labelPos = (edge.spline[1] + edge.spline[2]) / 2 + QPointF(2 * scale, 0);
+	}
+}
+
+QPointF LayeredLayout::border(const NodeLayout& node, const QPointF& toward)
+{
+	QPointF d = toward - node.center;
+	qreal a = node.size.width() / 2;
+	qreal b = node.size.height() / 2;
+	if (d.isNull() || a <= 0 || b <= 0)
+		return node.center;
+
+	// the factor t such that center + t*d is on the border
+	qreal t;
+	if (node.shape == "rect" || node.shape == "box") {
+		t = qMin(d.x() ? a / qAbs(d.x()) : HUGE_VAL, d.y() ? b / qAbs(d.y()) : HUGE_VAL);
+	} else if (node.shape == "diamond") {
+		t = 1 / (qAbs(d.x()) / a + qAbs(d.y()) / b);
+	} else {
+		t = 1 / qSqrt((d.x() / a) * (d.x() / a) + (d.y() / b) * (d.y() / b));
+	}
+	return node.center + qMin(t, qreal(1)) * d;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file layeredlayout.h
+ * @brief Definition of class LayeredLayout
+ */
+#ifndef LAYEREDLAYOUT_H
+#define LAYEREDLAYOUT_H
+
+#include <QPair>
+#include <QPointF>
+#include <QSizeF>
+#include <QVector>
+#include "diagramdata.h"
+#include "graphlayout.h"
+
+/**
+ * @brief This class computes a coarse layered layout of a diagram, in a few
+ * milliseconds even for huge diagrams.
+ *
+ * The layout follows the same principles as GraphViz's dot, with much
+ * cheaper heuristics: nodes are ranked by longest path from the sources
+ * (after breaking cycles with a depth-first search), ordered in their rank by
+ * a couple of barycenter sweeps, and placed side by side, each rank centered.
+ * Edges are straight lines. The result has the same form as a layout computed
+ * by GraphViz, and can be displayed while GraphViz is still at work.
+ *
+ * It can also compact an existing layout once some nodes are hidden, keeping
+ * the ranks and the order of the remaining nodes in their rank.
+ */
+class LayeredLayout
+{
+public:
+	/**
+	 * @brief Lays out a diagram.
+	 *
+	 * @param data the diagram
+	 * @param charSize the size of a character of the labels, in scene
+	 * coordinates (the labels are written in a monospace font)
+	 *
+	 * @return the layout of the diagram, in scene coordinates
+	 */
+	static GraphLayout compute(const DiagramData& data, const QSizeF& charSize);
+	/**
+	 * @brief Removes the holes left in a layout by hidden nodes.
+	 *
+	 * The empty horizontal and vertical bands between the visible nodes
+	 * are shrunk to the usual separation between ranks or nodes. The
+	 * ranks and the order of the nodes in each rank are preserved, and
+	 * the edges are bent along with their nodes, so this is much faster
+	 * than a new layout by GraphViz and looks the same.
+	 *
+	 * @param layout the current layout of the diagram
+	 * @param visible whether each node is visible
+	 * @param scale the ratio between scene coordinates and points
+	 *
+	 * @return the compacted layout, in which the hidden nodes and edges
+	 * are squeezed too
+	 */
+	static GraphLayout compact(const GraphLayout& layout, const QVector<bool>& visible, qreal scale);
+
+private:
+	/**
+	 * @brief A monotone mapping of coordinates along one axis, which
+	 * shrinks the empty bands between occupied intervals.
+	 */
+	class Compression
+	{
+	public:
+		/**
+		 * @brief Builds the mapping.
+		 *
+		 * @param intervals the occupied intervals, as pairs of bounds
+		 * @param separation the width to which empty bands are shrunk
+		 * @param margin the space before the first interval
+		 */
+		Compression(QVector<QPair<qreal,qreal>> intervals, qreal separation, qreal margin);
+		/**
+		 * @brief Maps a coordinate.
+		 *
+		 * @param x the coordinate in the original layout
+		 *
+		 * @return the coordinate in the compacted layout
+		 */
+		qreal map(qreal x) const;
+
+	private:
+		/**
+		 * @brief the merged occupied intervals, in order
+		 */
+		QVector<QPair<qreal,qreal>> _intervals;
+		/**
+		 * @brief the new start of each interval
+		 */
+		QVector<qreal> _starts;
+		/**
+		 * @brief the width of the empty bands once shrunk
+		 */
+		qreal _separation;
+	};
+
+	/**
+	 * @brief Ranks the nodes.
+	 *
+	 * @param data the diagram
+	 *
+	 * @return the rank of each node, 0 for the top rank
+	 */
+	static QVector<int> rank(const DiagramData& data);
+	/**
+	 * @brief Orders the nodes in each rank to reduce edge crossings.
+	 *
+	 * @param data the diagram
+	 * @param ranks the rank of each node
+	 *
+	 * @return the nodes of each rank, from left to right
+	 */
+	static QVector<QVector<int>> order(const DiagramData& data, const QVector<int>& ranks);
+	/**
+	 * @brief Gives the shape, size and label of a node, as dot would.
+	 *
+	 * @param data the diagram
+	 * @param node the index of the node
+	 * @param charSize the size of a character of the labels
+	 * @param scale the ratio between scene coordinates and points
+	 *
+	 * @return the layout of the node, not positioned yet
+	 */
+	static NodeLayout shape(const DiagramData& data, int node, const QSizeF& charSize, qreal scale);
+	/**
+	 * @brief Positions the nodes, rank by rank, and computes the bounding
+	 * box of the diagram.
+	 *
+	 * @param layers the nodes of each rank, from left to right
+	 * @param scale the ratio between scene coordinates and points
+	 * @param layout the layout whose nodes have their size, receives the
+	 * positions
+	 */
+	static void place(const QVector<QVector<int>>& layers, qreal scale, GraphLayout& layout);
+	/**
+	 * @brief Draws the edges as straight lines between their nodes.
+	 *
+	 * @param data the diagram
+	 * @param scale the ratio between scene coordinates and points
+	 * @param layout the layout whose nodes are positioned, receives the
+	 * edges
+	 */
+	static void route(const DiagramData& data, qreal scale, GraphLayout& layout);
+	/**
+	 * @brief Gives the point where a line from the center of a node
+	 * crosses its border.
+	 *
+	 * @param node the node
+	 * @param toward another point of the line
+	 *
+	 * @return the point on the border of the node
+	 */
+	static QPointF border(const NodeLayout& node, const QPointF& toward);
+};
+
+#endif // LAYEREDLAYOUT_H
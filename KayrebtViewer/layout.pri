@@ -0,0 +1,35 @@
+#-------------------------------------------------
+#
+# Layout of diagrams with GraphViz, shared by the viewer and the batch
+# pre-layout tool. Only depends on QtCore.
+#
+#-------------------------------------------------
+
+DEPENDPATH += . /usr/lib/graphviz
+INCLUDEPATH += . /usr/include/graphviz
+QMAKE_CXXFLAGS += -std=c++11
+
+unix:!macx: LIBS += -L/usr/lib/graphviz/ `pkg-config libgvc --libs`
+
+SOURCES += \
+    graphlayout.cpp \
+    layoutjob.cpp \
+    layoutscheduler.cpp \
+    layoutworker.cpp \
+    layoutcache.cpp \
+    dotreader.cpp \
+    stringpool.cpp \
+    diagramstore.cpp \
+    diagramstorewriter.cpp
+
+HEADERS += \
+    graphlayout.h \
+    layoutjob.h \
+    layoutscheduler.h \
+    layoutworker.h \
+    layoutcache.h \
+    dotreader.h \
+    diagramdata.h \
+    stringpool.h \
+    diagramstore.h \
+    diagramstorewriter.h
@@ -0,0 +1,142 @@
+/**
+ * @file layoutcache.cpp
+ * @brief Implementation of class LayoutCache
+ */
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QtGlobal>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#endif
+#include "layoutcache.h"
+
+const quint32 LayoutCache::MAGIC = 0x4b4c4331; // "KLC1"
+const quint16 LayoutCache::FORMAT_VERSION = 1;
+
+LayoutCache::LayoutCache()
+{
+	QSettings settings;
+	_directory = settings.value("layout cache dir").toString();
+	if (_directory.isEmpty())
+		_directory = defaultDirectory();
+	_enabled = settings.value("layout cache", true).toBool();
+}
+
+LayoutCache::LayoutCache(const QString& directory) :
+	_directory(directory),
+	_enabled(true)
+{
+}
+
+QString LayoutCache::defaultDirectory()
+{
+#if QT_VERSION >= 0x050000
+	QString base = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+#else
+	QString base = QString::fromLocal8Bit(qgetenv("XDG_CACHE_HOME"));
+	if (base.isEmpty())
+		base = QDir::homePath() + "/.cache";
+#endif
+	return base + "/kayrebt-viewer/layouts";
+}
+
+QByteArray LayoutCache::key(const QByteArray& dot)
+{
+	// The resolution of a diagram is one of its attributes, it is part of
+	// its text. The rest of the settings are fixed by the viewer.
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(QString("%1;%2;%3;%4;")
+				 .arg(FORMAT_VERSION)
+				 .arg(GraphLayout::DOT_DEFAULT_DPI)
+				 .arg(GraphLayout::FONT_FAMILY)
+				 .arg(GraphLayout::FONT_POINT_SIZE)
+				 .toLatin1());
+	hash.addData(dot);
+	return hash.result().toHex();
+}
+
+bool LayoutCache::isEnabled() const
+{
+	return _enabled;
+}
+
+const QString& LayoutCache::getDirectory() const
+{
+	return _directory;
+}
+
+QString LayoutCache::entryPath(const QByteArray& key) const
+{
+	return _directory + "/" + QString::fromLatin1(key.left(2)) + "/" + QString::fromLatin1(key.mid(2));
+}
+
+bool LayoutCache::load(const QByteArray& key, GraphLayout& layout) const
+{
+	if (!_enabled)
+		return false;
+
+	QFile entry(entryPath(key));
+	if (!entry.open(QIODevice::ReadOnly))
+		return false;
+
+	QDataStream header(&entry);
+	header.setVersion(QDataStream::Qt_4_8);
+	quint32 magic;
+	quint16 version;
+	QByteArray storedKey;
+	QByteArray compressed;
+	header >> magic >> version >> storedKey >> compressed;
+	if (header.status() != QDataStream::Ok || magic != MAGIC ||
+		version != FORMAT_VERSION || storedKey != key)
+		return false;
+
+	QByteArray data = qUncompress(compressed);
+	QDataStream in(data);
+	in.setVersion(QDataStream::Qt_4_8);
+	in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+	GraphLayout result;
+	in >> result;
+	if (in.status() != QDataStream::Ok)
+		return false;
+
+	layout = result;
+	return true;
+}
+
+bool LayoutCache::store(const QByteArray& key, const GraphLayout& layout) const
+{
+	if (!_enabled)
+		return false;
+
+	QString path = entryPath(key);
+	if (!QDir().mkpath(QFileInfo(path).absolutePath()))
+		return false;
+
+	QByteArray data;
+	QDataStream out(&data, QIODevice::WriteOnly);
+	out.setVersion(QDataStream::Qt_4_8);
+	out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+	out << layout;
+
+	// write in a temporary file first so that readers never see a
+	// partially written entry
+	QFile entry(QString("%1.%2.tmp").arg(path).arg(QCoreApplication::applicationPid()));
+	if (!entry.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+	QDataStream header(&entry);
+	header.setVersion(QDataStream::Qt_4_8);
+	header << MAGIC << FORMAT_VERSION << key << qCompress(data);
+	entry.close();
+	if (header.status() != QDataStream::Ok || entry.error() != QFile::NoError) {
+		entry.remove();
+		return false;
+	}
+
+	QFile::remove(path);
+	return entry.rename(path);
+}
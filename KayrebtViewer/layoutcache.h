@@ -0,0 +1,117 @@
+/**
+ * @file layoutcache.h
+ * @brief Definition of class LayoutCache
+ */
+#ifndef LAYOUTCACHE_H
+#define LAYOUTCACHE_H
+
+#include <QByteArray>
+#include <QString>
+#include "graphlayout.h"
+
+/**
+ * @brief This class is a persistent, on-disk, cache of diagram layouts.
+ *
+ * Each entry is a compact binary file containing a GraphLayout. Entries are
+ * identified by a key which is a hash of the diagram text and of all the
+ * settings influencing its layout (resolution, font, cache format), so that an
+ * entry is never used for a diagram it does not match. Entries are spread in
+ * subdirectories named after the first two characters of their key to keep
+ * directories small.
+ *
+ * The cache directory is taken from setting "layout cache dir", and defaults
+ * to a subdirectory of the user cache directory. The cache can be disabled
+ * with setting "layout cache".
+ */
+class LayoutCache
+{
+public:
+	/**
+	 * @brief Constructor. Uses the cache directory from the settings.
+	 */
+	LayoutCache();
+	/**
+	 * @brief Constructor.
+	 *
+	 * @param directory the directory where the entries are stored
+	 */
+	explicit LayoutCache(const QString& directory);
+
+	/**
+	 * @brief Gives the cache directory to use when it is not set.
+	 *
+	 * @return the default cache directory
+	 */
+	static QString defaultDirectory();
+	/**
+	 * @brief Computes the key of a diagram.
+	 *
+	 * @param dot the text of the diagram, in dot format
+	 *
+	 * @return the key of the diagram
+	 */
+	static QByteArray key(const QByteArray& dot);
+
+	/**
+	 * @brief Tells whether the cache is used at all.
+	 *
+	 * @return true if, and only if, the cache is enabled
+	 */
+	bool isEnabled() const;
+	/**
+	 * @brief Gives the directory where entries are stored.
+	 *
+	 * @return the cache directory
+	 */
+	const QString& getDirectory() const;
+	/**
+	 * @brief Looks for a layout in the cache.
+	 *
+	 * @param key the key of the diagram
+	 * @param layout receives the layout if it is found
+	 *
+	 * @return true if, and only if, a valid entry was found
+	 */
+	bool load(const QByteArray& key, GraphLayout& layout) const;
+	/**
+	 * @brief Adds a layout to the cache, replacing any previous entry with
+	 * the same key.
+	 *
+	 * @param key the key of the diagram
+	 * @param layout the layout of the diagram
+	 *
+	 * @return true if, and only if, the entry was written
+	 */
+	bool store(const QByteArray& key, const GraphLayout& layout) const;
+
+private:
+	/**
+	 * @brief Gives the path of the entry for a given key.
+	 *
+	 * @param key the key of the diagram
+	 *
+	 * @return the path of the entry file
+	 */
+	QString entryPath(const QByteArray& key) const;
+
+	/**
+	 * @brief the magic number at the beginning of each entry
+	 */
+	static const quint32 MAGIC;
+	/**
+	 * @brief the version of the entries format, to be incremented every
+	 * time the format of GraphLayout changes
+	 */
+	static const quint16 FORMAT_VERSION;
+
+	/**
+	 * @brief the directory where entries are stored
+	 */
+	QString _directory;
+	/**
+	 * @brief whether the cache is used
+	 */
+	bool _enabled;
+};
+
+#endif // LAYOUTCACHE_H
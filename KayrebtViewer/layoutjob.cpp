@@ -0,0 +1,41 @@
+/**
+ * @file layoutjob.cpp
+ * @brief Implementation of class LayoutJob
+ */
+#include "layoutjob.h"
+
+LayoutJob::LayoutJob(const QByteArray& dot, QObject* parent) :
+	QObject(parent),
+	_dot(dot)
+{
+}
+
+const QByteArray& LayoutJob::getDot() const
+{
+	return _dot;
+}
+
+const QByteArray& LayoutJob::getKey() const
+{
+	return _key;
+}
+
+bool LayoutJob::isFromCache() const
+{
+	return _fromCache;
+}
+
+LayoutScheduler::Priority LayoutJob::getPriority() const
+{
+	return _priority;
+}
+
+bool LayoutJob::isStarted() const
+{
+	return _started;
+}
+
+const GraphLayout& LayoutJob::getLayout() const
+{
+	return _layout;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file layoutjob.h
+ * @brief Definition of class LayoutJob
+ */
+#ifndef LAYOUTJOB_H
+#define LAYOUTJOB_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include "graphlayout.h"
+#include "layoutscheduler.h"
+
+/**
+ * @brief This class represents the layout of a diagram, submitted to the
+ * LayoutScheduler.
+ *
+ * Jobs are created and owned by the LayoutScheduler. A job is deleted by the
+ * scheduler once one of its signals finished() or failed() has been emitted,
+ * so the receivers must copy the result in their slots.
+ */
+class LayoutJob : public QObject
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * @brief Gives the text of the diagram to lay out.
+	 *
+	 * @return the diagram, in dot format
+	 */
+	const QByteArray& getDot() const;
+	/**
+	 * @brief Gives the key identifying the diagram in the LayoutCache.
+	 *
+	 * @return the key of the diagram
+	 */
+	const QByteArray& getKey() const;
+	/**
+	 * @brief Tells whether the layout was found in the LayoutCache instead
+	 * of being computed.
+	 *
+	 * @return true if, and only if, GraphViz was not run for this job
+	 */
+	bool isFromCache() const;
+	/**
+	 * @brief Gives the priority of the job.
+	 *
+	 * @return the priority the job is scheduled with
+	 */
+	LayoutScheduler::Priority getPriority() const;
+	/**
+	 * @brief Tells whether a worker has started laying out the diagram,
+	 * i.e. whether the signal started() has been emitted.
+	 *
+	 * @return true if, and only if, the job has been given to a worker
+	 */
+	bool isStarted() const;
+	/**
+	 * @brief Gives the result of the job.
+	 *
+	 * The result is only meaningful once the signal finished() has been
+	 * emitted.
+	 *
+	 * @return the layout of the diagram
+	 */
+	const GraphLayout& getLayout() const;
+
+signals:
+	/**
+	 * @brief This signal is emitted when a worker starts laying out the
+	 * diagram.
+	 *
+	 * It is not emitted for jobs whose layout is in the cache.
+	 */
+	void started();
+	/**
+	 * @brief This signal is emitted when the layout is available.
+	 */
+	void finished();
+	/**
+	 * @brief This signal is emitted when the diagram could not be laid
+	 * out.
+	 *
+	 * @param error a message explaining the failure
+	 */
+	void failed(const QString& error);
+
+private:
+	/**
+	 * @brief Constructor, reserved to the LayoutScheduler.
+	 *
+	 * @param dot the diagram to lay out, in dot format
+	 * @param parent the parent object, i.e. the scheduler
+	 */
+	explicit LayoutJob(const QByteArray& dot, QObject* parent = nullptr);
+
+	/**
+	 * @brief the diagram to lay out
+	 */
+	QByteArray _dot;
+	/**
+	 * @brief the key of the diagram in the layout cache
+	 */
+	QByteArray _key;
+	/**
+	 * @brief whether the layout comes from the cache
+	 */
+	bool _fromCache = false;
+	/**
+	 * @brief the priority of the job
+	 */
+	LayoutScheduler::Priority _priority = LayoutScheduler::NORMAL_PRIORITY;
+	/**
+	 * @brief whether the job has been given to a worker
+	 */
+	bool _started = false;
+	/**
+	 * @brief the layout, once computed
+	 */
+	GraphLayout _layout;
+
+friend class LayoutScheduler;
+};
+
+#endif // LAYOUTJOB_H
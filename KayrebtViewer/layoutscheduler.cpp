@@ -0,0 +1,303 @@
+/**
+ * @file layoutscheduler.cpp
+ * @brief Implementation of class LayoutScheduler
+ */
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+#include <QSettings>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include "graphlayout.h"
+#include "layoutjob.h"
+#include "layoutworker.h"
+#include "layoutscheduler.h"
+
+LayoutScheduler& LayoutScheduler::instance()
+{
+	static LayoutScheduler* scheduler = new LayoutScheduler(QCoreApplication::instance());
+	return *scheduler;
+}
+
+LayoutScheduler::LayoutScheduler(QObject* parent) :
+	QObject(parent)
+{
+	_maxWorkers = QSettings().value("layout workers", QThread::idealThreadCount()).toInt();
+	if (_maxWorkers < 1)
+		_maxWorkers = 1;
+	_timeout = 1000 * QSettings().value("layout timeout", 120).toInt();
+	_maxBackgroundWorkers = qMax(0, QSettings().value("prefetch workers", 1).toInt());
+}
+
+LayoutScheduler::~LayoutScheduler()
+{
+	for (Worker* w : _workers) {
+		w->process->disconnect(this);
+		if (w->job) {
+			w->process->kill(); // no need to wait for a result nobody wants
+			w->process->waitForFinished(1000);
+		} else {
+			w->process->closeWriteChannel(); // the worker exits at the end of its input
+			if (!w->process->waitForFinished(1000))
+				w->process->kill();
+		}
+		delete w;
+	}
+}
+
+int LayoutScheduler::getMaxWorkers() const
+{
+	return _maxWorkers;
+}
+
+void LayoutScheduler::setMaxWorkers(int maxWorkers)
+{
+	_maxWorkers = qMax(1, maxWorkers);
+	dispatch();
+}
+
+int LayoutScheduler::getMaxBackgroundWorkers() const
+{
+	return _maxBackgroundWorkers;
+}
+
+LayoutJob* LayoutScheduler::submit(const QByteArray& dot, Priority priority)
+{
+	QByteArray key = LayoutCache::key(dot);
+	if (priority == NORMAL_PRIORITY) {
+		LayoutJob* background = findBackgroundJob(key);
+		if (background) {
+			background->_priority = NORMAL_PRIORITY;
+			if (_background.removeOne(background)) {
+				_pending.prepend(background);
+				dispatch();
+			}
+			return background;
+		}
+	}
+
+	LayoutJob* job = new LayoutJob(QByteArray(), this);
+	job->_key = key;
+	job->_priority = priority;
+	if (_cache.load(job->_key, job->_layout)) {
+		job->_fromCache = true;
+		_cached.enqueue(job);
+		// let the caller connect to the job before it finishes
+		QTimer::singleShot(0, this, SLOT(deliverCachedJobs()));
+	} else {
+		// the text may not be owned by the caller (e.g. a file mapped in
+		// memory), keep a copy until it is sent to a worker
+		job->_dot = QByteArray(dot.constData(), dot.size());
+		if (priority == BACKGROUND_PRIORITY)
+			_background.enqueue(job);
+		else
+			_pending.enqueue(job);
+		dispatch();
+	}
+	return job;
+}
+
+void LayoutScheduler::cancel(LayoutJob* job)
+{
+	if (_pending.removeOne(job) || _background.removeOne(job) || _cached.removeOne(job)) {
+		job->deleteLater();
+		return;
+	}
+
+	for (Worker* w : _workers) {
+		if (w->job == job) {
+			w->job = nullptr;
+			w->timer->stop();
+			w->killed = true;
+			w->process->kill(); // workerExited() will remove the worker
+			job->deleteLater();
+			return;
+		}
+	}
+}
+
+void LayoutScheduler::deliverCachedJobs()
+{
+	while (!_cached.isEmpty()) {
+		LayoutJob* job = _cached.dequeue();
+		emit job->finished();
+		job->deleteLater();
+	}
+}
+
+LayoutJob* LayoutScheduler::findBackgroundJob(const QByteArray& key) const
+{
+	for (LayoutJob* job : _background)
+		if (job->_key == key)
+			return job;
+	for (Worker* w : _workers)
+		if (w->job && w->job->_priority == BACKGROUND_PRIORITY && w->job->_key == key)
+			return w->job;
+	return nullptr;
+}
+
+void LayoutScheduler::dispatch()
+{
+	for (;;) {
+		QQueue<LayoutJob*>* queue = &_pending;
+		if (_pending.isEmpty()) {
+			int backgroundWorkers = 0;
+			for (Worker* w : _workers)
+				if (w->job && w->job->_priority == BACKGROUND_PRIORITY)
+					backgroundWorkers++;
+			if (_background.isEmpty() || backgroundWorkers >= _maxBackgroundWorkers)
+				return;
+			queue = &_background;
+		}
+
+		Worker* idle = nullptr;
+		for (Worker* w : _workers) {
+			if (!w->job && !w->killed) {
+				idle = w;
+				break;
+			}
+		}
+		if (!idle) {
+			if (_workers.size() >= _maxWorkers)
+				return;
+			idle = startWorker();
+		}
+
+		idle->job = queue->dequeue();
+		QByteArray request;
+		QDataStream out(&request, QIODevice::WriteOnly);
+		out.setVersion(QDataStream::Qt_4_8);
+		out << quint8(LayoutWorker::LAYOUT_REQUEST) << idle->job->getDot();
+		idle->process->write(LayoutWorker::frame(request));
+		if (_timeout > 0)
+			idle->timer->start(_timeout);
+		idle->job->_started = true;
+		emit idle->job->started();
+	}
+}
+
+LayoutScheduler::Worker* LayoutScheduler::startWorker()
+{
+	Worker* w = new Worker;
+	w->process = new QProcess(this);
+	w->timer = new QTimer(this);
+	w->timer->setSingleShot(true);
+	connect(w->timer, SIGNAL(timeout()), this, SLOT(workerTimedOut()));
+	connect(w->process, SIGNAL(readyReadStandardOutput()), this, SLOT(readWorkerOutput()));
+	connect(w->process, SIGNAL(readyReadStandardError()), this, SLOT(readWorkerErrors()));
+	connect(w->process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(workerExited()));
+	connect(w->process, SIGNAL(error(QProcess::ProcessError)), this, SLOT(workerError(QProcess::ProcessError)));
+	_workers.append(w);
+	w->process->start(QCoreApplication::applicationFilePath(),
+					  QStringList() << LayoutWorker::COMMAND_LINE_SWITCH);
+	return w;
+}
+
+LayoutScheduler::Worker* LayoutScheduler::findWorker(QObject* object)
+{
+	for (Worker* w : _workers)
+		if (w->process == object || w->timer == object)
+			return w;
+	return nullptr;
+}
+
+void LayoutScheduler::readWorkerOutput()
+{
+	Worker* w = findWorker(sender());
+	if (!w || w->killed)
+		return;
+
+	w->buffer.append(w->process->readAllStandardOutput());
+	QByteArray payload;
+	while (LayoutWorker::unframe(w->buffer, payload))
+		handleAnswer(w, payload);
+	dispatch();
+}
+
+void LayoutScheduler::handleAnswer(Worker* worker, const QByteArray& payload)
+{
+	LayoutJob* job = worker->job;
+	worker->job = nullptr;
+	worker->timer->stop();
+	if (!job)
+		return;
+
+	QDataStream in(payload);
+	in.setVersion(QDataStream::Qt_4_8);
+	quint8 type;
+	in >> type;
+	if (type == LayoutWorker::LAYOUT_DONE) {
+		in >> job->_layout;
+		_cache.store(job->_key, job->_layout);
+		emit job->finished();
+	} else {
+		QString error;
+		in >> error;
+		emit job->failed(error);
+	}
+	job->deleteLater();
+}
+
+void LayoutScheduler::readWorkerErrors()
+{
+	QProcess* process = qobject_cast<QProcess*>(sender());
+	if (process)
+		qWarning() << "layout worker:" << process->readAllStandardError();
+}
+
+void LayoutScheduler::workerTimedOut()
+{
+	Worker* w = findWorker(sender());
+	if (!w || !w->job)
+		return;
+
+	w->timedOut = true;
+	w->killed = true;
+	w->process->kill(); // workerExited() will fail the job
+}
+
+void LayoutScheduler::workerError(QProcess::ProcessError error)
+{
+	// a process which failed to start never emits finished()
+	if (error == QProcess::FailedToStart)
+		workerExited();
+}
+
+void LayoutScheduler::workerExited()
+{
+	Worker* w = findWorker(sender());
+	if (!w)
+		return;
+
+	_workers.removeOne(w);
+	w->process->disconnect(this);
+	w->process->deleteLater();
+	w->timer->deleteLater();
+	bool startFailed = w->process->error() == QProcess::FailedToStart;
+	if (w->job) {
+		QString error;
+		if (w->timedOut)
+			error = tr("The layout took more than %1 seconds and was aborted.").arg(_timeout / 1000);
+		else if (w->process->exitStatus() == QProcess::CrashExit)
+			error = tr("GraphViz crashed while laying out the diagram.");
+		else
+			error = tr("The layout worker exited unexpectedly (exit code %1).").arg(w->process->exitCode());
+		emit w->job->failed(error);
+		w->job->deleteLater();
+	}
+	delete w;
+
+	if (startFailed) {
+		// no use trying again, fail everything
+		_pending.append(_background);
+		_background.clear();
+		while (!_pending.isEmpty()) {
+			LayoutJob* job = _pending.dequeue();
+			emit job->failed(tr("Could not start a layout worker."));
+			job->deleteLater();
+		}
+	} else {
+		dispatch();
+	}
+}
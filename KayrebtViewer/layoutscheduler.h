@@ -0,0 +1,290 @@
+/**
+ * @file layoutscheduler.h
+ * @brief Definition of class LayoutScheduler
+ */
+#ifndef LAYOUTSCHEDULER_H
+#define LAYOUTSCHEDULER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QQueue>
+#include <QProcess>
+#include <QTimer>
+#include "layoutcache.h"
+
+class LayoutJob;
+
+/**
+ * @brief This class dispatches the layout of diagrams to a pool of worker
+ * processes.
+ *
+ * GraphViz is not thread-safe: its layout engines keep their state in global
+ * variables. Laying out several diagrams at once is done by running one
+ * LayoutWorker process per core, each one with its own GraphViz context.
+ * Workers are started on demand and reused for subsequent jobs.
+ *
+ * The scheduler lives in the main thread and communicates with the workers
+ * asynchronously, through their standard input and output.
+ *
+ * Running GraphViz in separate processes also protects the viewer from
+ * pathological diagrams: a worker which crashes only fails its own job, and a
+ * worker which takes longer than the timeout set in setting "layout timeout"
+ * (in seconds, 0 for no timeout) is killed. Failed workers are replaced when
+ * the next job is dispatched.
+ *
+ * Layouts are looked up in the LayoutCache before being computed, and stored
+ * there once computed, so that GraphViz is run only once per diagram.
+ *
+ * Jobs submitted with the background priority (e.g. to prefetch diagrams the
+ * user may open next) only get a worker when no normal job is waiting, and
+ * occupy at most the number of workers set in setting "prefetch workers"
+ * (1 by default). A background job is promoted as soon as the same diagram is
+ * submitted with the normal priority.
+ */
+class LayoutScheduler : public QObject
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * @brief The priorities of the jobs
+	 */
+	enum Priority {
+		/**
+		 * @brief a diagram the user is waiting for
+		 */
+		NORMAL_PRIORITY,
+		/**
+		 * @brief a diagram laid out in advance
+		 */
+		BACKGROUND_PRIORITY
+	};
+
+	/**
+	 * @brief Gives the unique instance of the scheduler, creating it if
+	 * necessary.
+	 *
+	 * The instance is owned by the application object.
+	 *
+	 * @return the scheduler
+	 */
+	static LayoutScheduler& instance();
+
+	/**
+	 * @brief Submits a diagram to be laid out.
+	 *
+	 * If the layout is in the cache, the job finishes as soon as the
+	 * control returns to the event loop.
+	 *
+	 * If the same diagram has already been submitted in the background
+	 * and is not laid out yet, that job is promoted to @p priority and
+	 * returned instead of a new one. Its signal started() may already
+	 * have been emitted, see LayoutJob::isStarted().
+	 *
+	 * @param dot the diagram, in dot format, which may be released as
+	 * soon as this function returns
+	 * @param priority the priority of the job
+	 *
+	 * @return the job, whose signals tell when the layout is available
+	 */
+	LayoutJob* submit(const QByteArray& dot, Priority priority = NORMAL_PRIORITY);
+
+	/**
+	 * @brief Gives the maximum number of worker processes running at the
+	 * same time.
+	 *
+	 * It is taken from setting "layout workers", and defaults to the
+	 * number of cores.
+	 *
+	 * @return the maximum number of workers
+	 */
+	int getMaxWorkers() const;
+	/**
+	 * @brief Changes the maximum number of worker processes running at the
+	 * same time.
+	 *
+	 * Workers already running are not stopped.
+	 *
+	 * @param maxWorkers the maximum number of workers, at least 1
+	 */
+	void setMaxWorkers(int maxWorkers);
+	/**
+	 * @brief Gives the maximum number of workers running background jobs
+	 * at the same time.
+	 *
+	 * It is taken from setting "prefetch workers", 0 disables the
+	 * background jobs altogether.
+	 *
+	 * @return the maximum number of workers for background jobs
+	 */
+	int getMaxBackgroundWorkers() const;
+	/**
+	 * @brief Cancels a job.
+	 *
+	 * If the job is running, its worker is killed. The job is deleted
+	 * without emitting any signal, so @p job must not be used anymore
+	 * after this call.
+	 *
+	 * @param job the job to cancel
+	 */
+	void cancel(LayoutJob* job);
+
+private slots:
+	/**
+	 * @brief Finishes the jobs whose layout has been found in the cache.
+	 */
+	void deliverCachedJobs();
+	/**
+	 * @brief Reads the answers sent by a worker.
+	 *
+	 * This slot is triggered when a worker writes on its standard output.
+	 */
+	void readWorkerOutput();
+	/**
+	 * @brief Forwards the diagnostics written by a worker to the debug
+	 * output.
+	 */
+	void readWorkerErrors();
+	/**
+	 * @brief Forgets about a worker which has exited.
+	 *
+	 * The job it was running, if any, fails.
+	 */
+	void workerExited();
+	/**
+	 * @brief Forgets about a worker which could not be started.
+	 *
+	 * The other errors are either transient or followed by the exit of
+	 * the worker, handled by workerExited().
+	 *
+	 * @param error the error of the worker process
+	 */
+	void workerError(QProcess::ProcessError error);
+	/**
+	 * @brief Kills a worker which has been running its job for too long.
+	 *
+	 * This slot is triggered by the timer of the worker.
+	 */
+	void workerTimedOut();
+
+private:
+	/**
+	 * @brief A worker process and its current state.
+	 */
+	struct Worker
+	{
+		/**
+		 * @brief the worker process
+		 */
+		QProcess* process = nullptr;
+		/**
+		 * @brief the job being run by the worker, or null if it is idle
+		 */
+		LayoutJob* job = nullptr;
+		/**
+		 * @brief the bytes received from the worker and not processed yet
+		 */
+		QByteArray buffer;
+		/**
+		 * @brief the timer limiting the duration of the current job
+		 */
+		QTimer* timer = nullptr;
+		/**
+		 * @brief whether the worker has been killed and must not be
+		 * given any new job
+		 */
+		bool killed = false;
+		/**
+		 * @brief whether the worker was killed because of a timeout
+		 */
+		bool timedOut = false;
+	};
+
+	/**
+	 * @brief Constructor.
+	 *
+	 * @param parent the parent object, the application
+	 */
+	explicit LayoutScheduler(QObject* parent = nullptr);
+	/**
+	 * @brief Terminates all workers.
+	 */
+	~LayoutScheduler();
+
+	/**
+	 * @brief Hands pending jobs to idle workers, starting new workers if
+	 * the limit is not reached.
+	 *
+	 * Normal jobs go first, background jobs are dispatched only when
+	 * there is no normal job left and within their own limit.
+	 */
+	void dispatch();
+	/**
+	 * @brief Finds a background job not finished yet for a diagram.
+	 *
+	 * @param key the cache key of the diagram
+	 *
+	 * @return the job, or null if there is none
+	 */
+	LayoutJob* findBackgroundJob(const QByteArray& key) const;
+	/**
+	 * @brief Starts a new worker process.
+	 *
+	 * @return the new worker
+	 */
+	Worker* startWorker();
+	/**
+	 * @brief Finds the worker running as a given process, or using a given
+	 * timer.
+	 *
+	 * @param object the worker process or timer
+	 *
+	 * @return the worker, or null if there is none
+	 */
+	Worker* findWorker(QObject* object);
+	/**
+	 * @brief Processes an answer received from a worker.
+	 *
+	 * @param worker the worker which sent the answer
+	 * @param payload the answer
+	 */
+	void handleAnswer(Worker* worker, const QByteArray& payload);
+
+	/**
+	 * @brief the running workers
+	 */
+	QList<Worker*> _workers;
+	/**
+	 * @brief the jobs waiting for a worker
+	 */
+	QQueue<LayoutJob*> _pending;
+	/**
+	 * @brief the background jobs waiting for a worker
+	 */
+	QQueue<LayoutJob*> _background;
+	/**
+	 * @brief the jobs whose layout has been found in the cache, waiting
+	 * to be delivered
+	 */
+	QQueue<LayoutJob*> _cached;
+	/**
+	 * @brief the maximum number of workers
+	 */
+	int _maxWorkers;
+	/**
+	 * @brief the maximum number of workers running background jobs
+	 */
+	int _maxBackgroundWorkers;
+	/**
+	 * @brief the maximum duration of a job, in milliseconds, 0 if there is
+	 * no limit
+	 */
+	int _timeout;
+	/**
+	 * @brief the persistent layout cache
+	 */
+	LayoutCache _cache;
+};
+
+#endif // LAYOUTSCHEDULER_H
@@ -0,0 +1,81 @@
+/**
+ * @file layoutworker.cpp
+ * @brief Implementation of class LayoutWorker
+ */
+#include <cstdio>
+#include <stdexcept>
+#include <QDataStream>
+#include <QString>
+#include <QtEndian>
+#include <gvc.h>
+#include "graphlayout.h"
+#include "layoutworker.h"
+
+const char* const LayoutWorker::COMMAND_LINE_SWITCH = "--layout-worker";
+
+namespace {
+	bool readFrame(std::FILE* in, QByteArray& payload)
+	{
+		uchar header[4];
+		if (std::fread(header, 1, sizeof(header), in) != sizeof(header))
+			return false;
+		quint32 length = qFromBigEndian<quint32>(header);
+		payload.resize(length);
+		return std::fread(payload.data(), 1, length, in) == length;
+	}
+
+	bool writeFrame(std::FILE* out, const QByteArray& payload)
+	{
+		QByteArray f = LayoutWorker::frame(payload);
+		return std::fwrite(f.constData(), 1, f.size(), out) == static_cast<size_t>(f.size())
+			&& std::fflush(out) == 0;
+	}
+}
+
+QByteArray LayoutWorker::frame(const QByteArray& payload)
+{
+	QByteArray f(4, '\0');
+	qToBigEndian<quint32>(payload.size(), reinterpret_cast<uchar*>(f.data()));
+	return f.append(payload);
+}
+
+bool LayoutWorker::unframe(QByteArray& buffer, QByteArray& payload)
+{
+	if (buffer.size() < 4)
+		return false;
+	quint32 length = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(buffer.constData()));
+	if (static_cast<quint32>(buffer.size()) - 4 < length)
+		return false;
+	payload = buffer.mid(4, length);
+	buffer.remove(0, 4 + length);
+	return true;
+}
+
+int LayoutWorker::exec()
+{
+	GVC_t* gvc = gvContext();
+	QByteArray request;
+	while (readFrame(stdin, request)) {
+		QDataStream in(request);
+		in.setVersion(QDataStream::Qt_4_8);
+		quint8 type;
+		QByteArray dot;
+		in >> type >> dot;
+		if (type != LAYOUT_REQUEST)
+			continue;
+
+		QByteArray response;
+		QDataStream out(&response, QIODevice::WriteOnly);
+		out.setVersion(QDataStream::Qt_4_8);
+		try {
+			GraphLayout layout = GraphLayout::compute(dot, gvc);
+			out << quint8(LAYOUT_DONE) << layout;
+		} catch (std::runtime_error& e) {
+			out << quint8(LAYOUT_FAILED) << QString(e.what());
+		}
+		if (!writeFrame(stdout, response))
+			break;
+	}
+	gvFreeContext(gvc);
+	return 0;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file layoutworker.h
+ * @brief Definition of class LayoutWorker
+ */
+#ifndef LAYOUTWORKER_H
+#define LAYOUTWORKER_H
+
+#include <QByteArray>
+
+/**
+ * @brief This class is the main loop of a layout worker process.
+ *
+ * GraphViz layout engines rely on global state and cannot run several layouts
+ * at once in the same process. Diagrams are therefore laid out in separate
+ * processes (the viewer executable itself, started with the command line
+ * switch @a COMMAND_LINE_SWITCH), each one owning its own GraphViz context.
+ *
+ * A worker reads layout requests on its standard input and writes the results
+ * on its standard output, until its standard input is closed. Every message is
+ * a frame made of its length as a 32-bit big-endian integer, followed by a
+ * payload serialized with QDataStream, starting with a @a MessageType.
+ */
+class LayoutWorker
+{
+public:
+	/**
+	 * @brief the types of the messages exchanged with a worker
+	 */
+	enum MessageType {
+		/**
+		 * @brief a request to lay out a diagram, followed by its text
+		 */
+		LAYOUT_REQUEST = 1,
+		/**
+		 * @brief a successful answer, followed by the GraphLayout
+		 */
+		LAYOUT_DONE,
+		/**
+		 * @brief a failed answer, followed by an error message
+		 */
+		LAYOUT_FAILED
+	};
+
+	/**
+	 * @brief the command line switch which starts the executable as a
+	 * layout worker
+	 */
+	static const char* const COMMAND_LINE_SWITCH;
+
+	/**
+	 * @brief Runs the main loop of the worker on the process standard
+	 * input and output.
+	 *
+	 * @return the exit code of the worker process
+	 */
+	static int exec();
+
+	/**
+	 * @brief Wraps a payload into a frame ready to be written on a pipe.
+	 *
+	 * @param payload the message
+	 *
+	 * @return the frame
+	 */
+	static QByteArray frame(const QByteArray& payload);
+	/**
+	 * @brief Extracts the first complete frame from a buffer.
+	 *
+	 * @param buffer the data received so far, the frame is removed from
+	 * it if it is complete
+	 * @param payload receives the message carried by the frame
+	 *
+	 * @return true if, and only if, a complete frame was available
+	 */
+	static bool unframe(QByteArray& buffer, QByteArray& payload);
+};
+
+#endif // LAYOUTWORKER_H
@@ -6,7 +6,9 @@
  */
 #include "viewer.h"
 #include "preferencesdialog.h"
+#include "layoutworker.h"
 #include <QApplication>
+#include <cstring>
 #include <graph.h>
 
 /**
@@ -16,6 +18,9 @@
  * This function first displays the preferences dialog, and once the settings
  * are accepted, it shows the main window.
  *
+ * When started with the switch LayoutWorker::COMMAND_LINE_SWITCH, the program
+ * runs as a layout worker process instead, without any user interface.
+ *
  * @param argc number of arguments, passed to QApplication's constructor
  * @param argv[] the arguments, passed to QApplication's constructor
  *
@@ -24,6 +29,9 @@
  */
 int main(int argc, char *argv[])
 {
+	if (argc > 1 && std::strcmp(argv[1], LayoutWorker::COMMAND_LINE_SWITCH) == 0)
+		return LayoutWorker::exec();
+
 	QCoreApplication::setOrganizationName("IRISA");
 	QCoreApplication::setApplicationName("Kayrebt::Viewer");
 
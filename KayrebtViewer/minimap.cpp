@@ -0,0 +1,132 @@
+/**
+ * @file minimap.cpp
+ * @brief Implementation of class Minimap
+ */
+#include <QMouseEvent>
+#include <QPainter>
+#include <QtCore>
+#if QT_VERSION >= 0x050000
+#include <QtConcurrent/QtConcurrentRun>
+#else
+#include <QtConcurrentRun>
+#endif
+#include "minimap.h"
+#include "graph.h"
+#include "scenesnapshot.h"
+
+Minimap::Minimap(const Graph* graph, QWidget* parent) :
+	QWidget(parent),
+	_graph(graph)
+{
+	setCursor(Qt::PointingHandCursor);
+	connect(&_watcher, SIGNAL(finished()), this, SLOT(renderDone()));
+	refresh();
+}
+
+Minimap::~Minimap()
+{
+	_watcher.waitForFinished();
+}
+
+void Minimap::refresh()
+{
+	_sceneRect = _graph->sceneRect();
+	if (_sceneRect.isEmpty())
+		return;
+	qreal scale = qMin(MAX_SIZE / _sceneRect.width(), MAX_SIZE / _sceneRect.height());
+	QSize size(qMax(1, qRound(_sceneRect.width() * scale)), qMax(1, qRound(_sceneRect.height() * scale)));
+	if (size != _thumbnail.size()) {
+		_thumbnail = QImage(size, QImage::Format_ARGB32_Premultiplied);
+		_thumbnail.fill(0);
+		setFixedSize(size + QSize(2, 2));
+	}
+	_dirty = _thumbnail.rect();
+	startRender();
+}
+
+void Minimap::patch(const QVector<QRectF>& areas)
+{
+	if (_thumbnail.isNull())
+		return;
+	QRectF changed;
+	for (const QRectF& area : areas)
+		changed |= area;
+	const qreal margin = SceneSnapshot::MARGIN;
+	changed.adjust(-margin, -margin, margin, margin);
+	_dirty |= toThumbnail(changed).toAlignedRect() & _thumbnail.rect();
+	startRender();
+}
+
+void Minimap::startRender()
+{
+	if (_watcher.isRunning() || _dirty.isEmpty())
+		return;
+	_rendering = _dirty;
+	_renderingSize = _thumbnail.size();
+	_dirty = QRect();
+	// the changes made in the meantime mark the thumbnail dirty again
+	_watcher.setFuture(QtConcurrent::run(&SceneSnapshot::render, SceneSnapshot::take(*_graph),
+										 toScene(_rendering), _rendering.size()));
+}
+
+void Minimap::renderDone()
+{
+	if (_renderingSize == _thumbnail.size()) {
+		QPainter painter(&_thumbnail);
+		painter.setCompositionMode(QPainter::CompositionMode_Source);
+		painter.drawImage(_rendering.topLeft(), _watcher.result());
+		update();
+	}
+	startRender();
+}
+
+QRectF Minimap::toThumbnail(const QRectF& rect) const
+{
+	qreal scale = _thumbnail.width() / _sceneRect.width();
+	return QRectF((rect.topLeft() - _sceneRect.topLeft()) * scale, rect.size() * scale);
+}
+
+QRectF Minimap::toScene(const QRectF& rect) const
+{
+	qreal scale = _sceneRect.width() / _thumbnail.width();
+	return QRectF(_sceneRect.topLeft() + rect.topLeft() * scale, rect.size() * scale);
+}
+
+void Minimap::setViewRect(const QRectF& view)
+{
+	if (view == _view)
+		return;
+	_view = view;
+	setVisible(!_thumbnail.isNull() && !view.contains(_sceneRect));
+	update();
+}
+
+void Minimap::paintEvent(QPaintEvent*)
+{
+	QPainter painter(this);
+	painter.fillRect(rect(), QColor(255, 255, 255, 224));
+	painter.setPen(Qt::gray);
+	painter.drawRect(rect().adjusted(0, 0, -1, -1));
+	painter.drawImage(1, 1, _thumbnail);
+	painter.setPen(Qt::red);
+	painter.setClipRect(rect().adjusted(1, 1, -1, -1));
+	painter.drawRect(toThumbnail(_view).translated(1, 1));
+}
+
+void Minimap::mousePressEvent(QMouseEvent* event)
+{
+	if (event->button() != Qt::LeftButton) {
+		QWidget::mousePressEvent(event);
+		return;
+	}
+	emit centerRequested(toScene(QRectF(event->pos() - QPoint(1, 1), QSizeF())).topLeft());
+}
+
+void Minimap::mouseMoveEvent(QMouseEvent* event)
+{
+	if (!(event->buttons() & Qt::LeftButton)) {
+		QWidget::mouseMoveEvent(event);
+		return;
+	}
+	emit centerRequested(toScene(QRectF(event->pos() - QPoint(1, 1), QSizeF())).topLeft());
+}
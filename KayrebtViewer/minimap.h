@@ -0,0 +1,151 @@
+/**
+ * @file minimap.h
+ * @brief Definition of class Minimap
+ */
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include <QWidget>
+#include <QFutureWatcher>
+#include <QImage>
+#include <QPointF>
+#include <QRect>
+#include <QRectF>
+#include <QVector>
+
+class Graph;
+
+/**
+ * @brief This class displays a thumbnail of a whole diagram, with the part
+ * shown by the view framed, and lets the user move the view by clicking or
+ * dragging in it.
+ *
+ * The thumbnail is rendered in a background thread from a SceneSnapshot,
+ * once the diagram is built and each time its layout changes. When elements
+ * are highlighted or hidden, only the part of the thumbnail they cover is
+ * rendered again and patched in.
+ */
+class Minimap : public QWidget
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * @brief Constructor.
+	 *
+	 * @param graph the diagram, which must be built
+	 * @param parent the parent widget, over which the minimap floats
+	 */
+	explicit Minimap(const Graph* graph, QWidget* parent = nullptr);
+	/**
+	 * @brief Destroys the minimap, waiting for the rendering in progress.
+	 */
+	~Minimap();
+	/**
+	 * @brief Sets the part of the diagram shown by the view.
+	 *
+	 * The minimap hides itself when the whole diagram is shown.
+	 *
+	 * @param view the part of the scene shown, in scene coordinates
+	 */
+	void setViewRect(const QRectF& view);
+
+	/**
+	 * @brief the maximum width and height of the thumbnail, in pixels
+	 */
+	static const int MAX_SIZE = 200;
+
+public slots:
+	/**
+	 * @brief Renders the whole thumbnail again, for a new layout.
+	 */
+	void refresh();
+	/**
+	 * @brief Renders again the parts of the thumbnail covering some areas
+	 * of the diagram.
+	 *
+	 * @param areas the areas which have changed, in scene coordinates
+	 */
+	void patch(const QVector<QRectF>& areas);
+
+signals:
+	/**
+	 * @brief This signal is emitted when the user clicks or drags in the
+	 * minimap.
+	 *
+	 * @param point the point of the diagram to show at the center of the
+	 * view, in scene coordinates
+	 */
+	void centerRequested(const QPointF& point);
+
+protected:
+	virtual void paintEvent(QPaintEvent* event) override;
+	virtual void mousePressEvent(QMouseEvent* event) override;
+	virtual void mouseMoveEvent(QMouseEvent* event) override;
+
+private slots:
+	/**
+	 * @brief When this slot is triggered, a part of the thumbnail has been
+	 * rendered and can be patched in.
+	 */
+	void renderDone();
+
+private:
+	/**
+	 * @brief Starts rendering the parts of the thumbnail waiting to be,
+	 * unless a rendering is in progress.
+	 */
+	void startRender();
+	/**
+	 * @brief Converts a rectangle from scene to thumbnail coordinates.
+	 *
+	 * @param rect a rectangle of the scene
+	 *
+	 * @return the rectangle in the thumbnail
+	 */
+	QRectF toThumbnail(const QRectF& rect) const;
+	/**
+	 * @brief Converts a rectangle from thumbnail to scene coordinates.
+	 *
+	 * @param rect a rectangle of the thumbnail
+	 *
+	 * @return the rectangle in the scene
+	 */
+	QRectF toScene(const QRectF& rect) const;
+
+	/**
+	 * @brief the diagram
+	 */
+	const Graph* _graph;
+	/**
+	 * @brief the part of the scene in the thumbnail
+	 */
+	QRectF _sceneRect;
+	/**
+	 * @brief the thumbnail
+	 */
+	QImage _thumbnail;
+	/**
+	 * @brief the part of the scene shown by the view
+	 */
+	QRectF _view;
+	/**
+	 * @brief the rendering in progress
+	 */
+	QFutureWatcher<QImage> _watcher;
+	/**
+	 * @brief the part of the thumbnail being rendered
+	 */
+	QRect _rendering;
+	/**
+	 * @brief the size of the thumbnail when the rendering in progress
+	 * started
+	 */
+	QSize _renderingSize;
+	/**
+	 * @brief the part of the thumbnail waiting to be rendered
+	 */
+	QRect _dirty;
+};
+
+#endif // MINIMAP_H
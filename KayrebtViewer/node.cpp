@@ -5,130 +5,72 @@
  * @brief Implementation for class Node
  */
 #include <functional>
-#include <QFont>
 #include <QDebug>
-#include <QAbstractGraphicsShapeItem>
-#include <QGraphicsRectItem>
-#include <QGraphicsEllipseItem>
+#include <QPainter>
 #include <QCursor>
-#include <QApplication>
-#include <QGraphicsSceneMouseEvent>
-#include <QWidget>
-#include <cstring>
 #include "node.h"
 #include "graph.h"
 #include "element.h"
 
-Node::Node(Agnode_t *v, Graph *graph) :
+Node::Node(int v, const NodeGeometry& geometry, Graph *graph) :
 	Element(graph),
-	_gv_node(v),
-	_label(new QGraphicsSimpleTextItem(this))
+	_index(v)
 {
-	_inner = draw();
-	_inner->setPen(defaultPen);
-
-	_url = agget(_gv_node,"URL");
-	if (!_url.isEmpty()) {
-		setCursor(QCursor(Qt::PointingHandCursor));
-	}
-
-	QString line(agget(_gv_node, "line"));
-	if (!line.isEmpty()) {
-		_line = line.toInt();
-	}
-	_file = QString(agget(_gv_node, "filename"));
-
-	setAcceptHoverEvents(true);
-	connect(this, SIGNAL(nodeWithLineInformationHovered(int,QString&)), _graph, SLOT(highlightLineInSourceCode(int,QString&)));
+	assign(v, geometry);
 }
 
-QAbstractGraphicsShapeItem *Node::draw()
+void Node::assign(int v, const NodeGeometry& geometry)
 {
-	qreal dpi = _graph->getDpi();
-	qreal scale = dpi/_graph->DOT_DEFAULT_DPI;
-	const Agraph_t* g = _graph->getAgraph();
-
-	QString shape = ND_shape(_gv_node)->name;
-	QAbstractGraphicsShapeItem* res;
-	if (shape == "rect") {
-		res = new QGraphicsRectItem(ND_coord(_gv_node).x*scale - ND_width(_gv_node)*dpi/2,
-										 (GD_bb(g).UR.y - ND_coord(_gv_node).y)*scale - ND_height(_gv_node)*dpi/2,
-										 ND_width(_gv_node)*dpi,
-										 ND_height(_gv_node)*dpi,
-										 this);
-	} else if (shape == "diamond") {
-		QPainterPath path;
-		QPointF center(ND_coord(_gv_node).x*scale, (GD_bb(g).UR.y - ND_coord(_gv_node).y)*scale);
-		QPointF top(center - QPointF(0, ND_height(_gv_node)*dpi/2));
-		QPointF left(center - QPointF(ND_width(_gv_node)*dpi/2, 0));
-		QPointF bottom(center + QPointF(0, ND_height(_gv_node)*dpi/2));
-		QPointF right(center + QPointF(ND_width(_gv_node)*dpi/2, 0));
-
-		path.moveTo(top);
-		path.lineTo(left);
-		path.lineTo(bottom);
-		path.lineTo(right);
-		path.lineTo(top);
-		res = new QGraphicsPathItem(path, this);
-	} else { // by default: ellipse
-		res = new QGraphicsEllipseItem(ND_coord(_gv_node).x*scale - ND_width(_gv_node)*dpi/2,
-										 (GD_bb(g).UR.y - ND_coord(_gv_node).y)*scale - ND_height(_gv_node)*dpi/2,
-										 ND_width(_gv_node)*dpi,
-										 ND_height(_gv_node)*dpi,
-										 this);
-	}
-
-	if (ND_label(_gv_node)) {
-		QString label(ND_label(_gv_node)->text);
-		label.replace("\\n","\n");
-		_label->setText(label);
-		_label->setFont(_graph->MONOSPACE_FONT);
-		QRectF rectLabel(_label->boundingRect());
-		QRectF rectShape(res->boundingRect());
-		qreal offset_w =  (rectShape.width() - rectLabel.width()) / 2;
-		qreal offset_h =  (rectShape.height() - rectLabel.height()) / 2;
-		_label->setPos(ND_coord(_gv_node).x*scale - ND_width(_gv_node)*dpi/2 + offset_w,
-					   (GD_bb(g).UR.y - ND_coord(_gv_node).y)*scale - ND_height(_gv_node)*dpi/2 + offset_h);
+	_index = v;
+	const DiagramData& data = _graph->getData();
+	_url = data.getNodeUrl(_index);
+	if (!_url.isEmpty()) {
+		setCursor(QCursor(Qt::PointingHandCursor));
+	} else {
+		unsetCursor();
 	}
-	return res;
-}
-
-Node::~Node()
-{
-	delete _label;
+	setGeometry(geometry);
 }
 
-void Node::hide()
+void Node::setGeometry(const NodeGeometry& geometry)
 {
-	agsafeset(_gv_node,"style","invisible","invisible");
-	QGraphicsItem::hide();
+	// everything has been computed beforehand, out of the GUI thread
+	_geometry = geometry;
+	setBounds(_geometry.outline.boundingRect(), _geometry.labelRect);
 }
 
-void Node::mouseDoubleClickEvent(QGraphicsSceneMouseEvent*)
+void Node::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *)
 {
-	_graph->pimpSubTree(this, &Element::hide, &Node::isVisible,true);
-	_graph->pimpSubTree(this, &Element::unhighlight);
+	paintNode(painter, _geometry, _highlighted,
+			  _graph->getLabelDetailThreshold(), _graph->getShapeDetailThreshold());
 }
 
-void Node::mousePressEvent(QGraphicsSceneMouseEvent* event)
+void Node::paintNode(QPainter *painter, const NodeGeometry& geometry, bool highlighted,
+					 qreal labelThreshold, qreal shapeThreshold)
 {
-	if (event->button() == Qt::LeftButton && event->modifiers() == Qt::ControlModifier && !_url.isEmpty()) {
-		_graph->callOtherGraph(_url);
-	} else {
-		Element::mousePressEvent(event);
+	const QPen& pen = getPen(highlighted);
+	qreal detail = levelOfDetail(painter);
+	if (detail < shapeThreshold) {
+		// the node is only a few pixels wide, its exact shape could
+		// not be told apart anyway
+		bool antialiased = painter->testRenderHint(QPainter::Antialiasing);
+		painter->setRenderHint(QPainter::Antialiasing, false);
+		painter->fillRect(geometry.outline.boundingRect(), pen.brush());
+		painter->setRenderHint(QPainter::Antialiasing, antialiased);
+		return;
 	}
-}
 
-void Node::hoverEnterEvent(QGraphicsSceneHoverEvent *)
-{
-	_graph->pimpSubTree(this,&Element::highlight);
-	if (_line && _file.size() != 0)
-		emit nodeWithLineInformationHovered(_line, _file);
+	painter->setPen(pen);
+	painter->setBrush(Qt::NoBrush);
+	painter->drawPath(geometry.outline);
+	if (detail >= labelThreshold)
+		paintLabel(painter, geometry.label, geometry.labelRect);
 }
 
-void Node::hoverLeaveEvent(QGraphicsSceneHoverEvent *)
+void Node::hide()
 {
-	_graph->pimpSubTree(this, &Element::unhighlight);
+	_graph->markNodeHidden(_index);
+	QGraphicsItem::hide();
 }
 
 bool Node::hasHighlightedAncestor() const
@@ -7,123 +7,93 @@
 #ifndef NODE_H
 #define NODE_H
 
-#include <QGraphicsObject>
-#include <QGraphicsSimpleTextItem>
-#include <QAbstractGraphicsShapeItem>
-#include <QPen>
-#include <QFont>
-#include <gvc.h>
+#include <QString>
 #include <types.h>
 #include "element.h"
+#include "scenegeometry.h"
 
 class Graph;
 
 
 /**
  * @brief This class represents a node in a diagram, associated with the
- * corresponding GraphViz data structure.
+ * node of the diagram read from the file.
+ *
+ * The mouse events are not handled by the node itself but by its Graph,
+ * which finds the node under the mouse from its spatial index.
  */
 class Node : public Element
 {
-	Q_OBJECT
 public:
 	/**
-	 * @brief Constructor. Builds a node from a GraphViz Agnode_t.
+	 * @brief Constructor. Builds a node of the diagram.
 	 *
-	 * @param v the GraphViz data structure representing the node
+	 * @param v the index of the node in the diagram
+	 * @param geometry the shapes of the node
 	 * @param graph the graph in which the Node is added
-	 * @param parent the parent object of the Node
 	 */
-	explicit Node(Agnode_t *v, Graph* graph);
-	/**
-	 * @brief Destroys the Node and frees associated GraphViz's resources.
-	 */
-	~Node();
+	explicit Node(int v, const NodeGeometry& geometry, Graph* graph);
 	/**
 	 * @brief Mark the Node as invisible.
 	 *
 	 * The Node continues occupying as much place as before and the graph
 	 * is not laid out again.
 	 */
-	virtual void hide();
-
-	virtual bool hasHighlightedAncestor() const override;
-
-signals:
+	virtual void hide() override;
 	/**
-	 * @brief This signal is emitted when a user activates the hyperlink
-	 * contained in the node.
+	 * @brief Makes the Node stand for another node of the diagram.
 	 *
-	 * This signal can be emitted only if the Node embeds a URL attribute.
+	 * This is used to recycle the items of the nodes which are scrolled
+	 * out of view. The state of the Node is kept, it is up to the caller
+	 * to set it.
 	 *
-	 * @param url the URL emitted
+	 * @param v the index of the node in the diagram
+	 * @param geometry the shapes of the node
 	 */
-	void hyperlinkActivated(const QString& url);
-
-public slots:
+	void assign(int v, const NodeGeometry& geometry);
 	/**
-	 * @brief Hides the node.
-	 *
-	 * This slot is triggered when the user double-clicks on the Node.
-	 *
-	 * @param UNUSED <i>unused</i>
-	 */
-	void mouseDoubleClickEvent(QGraphicsSceneMouseEvent * UNUSED);
-	/**
-	 * @brief Highlights the Node and all the elements of the diagram
-	 * reachable from it.
-	 *
-	 * This slot is triggered when the user hovers the node with its mouse
-	 * pointer.
+	 * @brief Moves and reshapes the Node, keeping its state.
 	 *
-	 * @param UNUSED <i>unused</i>
+	 * @param geometry the new shapes of the node
 	 */
-	void hoverEnterEvent(QGraphicsSceneHoverEvent * UNUSED);
+	void setGeometry(const NodeGeometry& geometry);
+
+	virtual bool hasHighlightedAncestor() const override;
 	/**
-	 * @brief Reverses the effect of hoverEnterEvent().
-	 *
-	 * This slot is triggered when the mouse pointer leaves the Node.
-	 *
-	 * @param UNUSED <i>unused</i>
+	 * @brief Draws the outline and the text of the Node.
 	 */
-	void hoverLeaveEvent(QGraphicsSceneHoverEvent * UNUSED);
+	void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
 	/**
-	 * @brief Activates the hyperlink in the Node if the user holds key
-	 * Ctrl.
+	 * @brief Draws a node.
 	 *
-	 * This slot is triggered when the user clicks on the Node.
+	 * This function does not need an item and can be called from any
+	 * thread, to paint on an image.
 	 *
-	 * @param UNUSED <i>unused</i>
+	 * @param painter the painter to draw with
+	 * @param geometry the shapes of the node
+	 * @param highlighted whether the node is highlighted
+	 * @param labelThreshold the level of detail under which the label is
+	 * not drawn
+	 * @param shapeThreshold the level of detail under which the node is
+	 * drawn as a filled rectangle
 	 */
-	void mousePressEvent(QGraphicsSceneMouseEvent* UNUSED);
-
-signals:
-	void nodeWithLineInformationHovered(int line, QString& filename);
+	static void paintNode(QPainter *painter, const NodeGeometry& geometry, bool highlighted,
+						  qreal labelThreshold, qreal shapeThreshold);
 
 private:
 	/**
-	 * @brief the GraphViz data structure representing the node
+	 * @brief the index of the node in the diagram
 	 */
-	Agnode_t* _gv_node;
+	int _index;
 	/**
-	 * @brief the text of the Node
+	 * @brief the shapes of the Node
 	 */
-	QGraphicsSimpleTextItem* _label;
+	NodeGeometry _geometry;
 	/**
 	 * @brief the URL carried by the node, possibly empty
 	 */
 	QString _url;
 
-	int _line = 0;
-	QString _file;
-
-	/**
-	 * @brief Draws the Node, using GraphViz's layout information
-	 *
-	 * @return the Node shape, without the text inside
-	 */
-	QAbstractGraphicsShapeItem* draw();
-
 friend class Graph;
 };
 
@@ -9,6 +9,8 @@
 #include <QSettings>
 #include <QFileDialog>
 
+const char* const PreferencesDialog::SCENE_INDEXES[] = { "automatic", "bsp", "none" };
+
 PreferencesDialog::PreferencesDialog(QWidget *parent) :
 	QDialog(parent),
 	ui(new Ui::PreferencesDialog)
@@ -18,6 +20,10 @@ PreferencesDialog::PreferencesDialog(QWidget *parent) :
 	ui->sourceTreeEdit->setText(settings.value("source tree", QString()).toString());
 	ui->dbEdit->setText(settings.value("symbol database", QString()).toString());
 	ui->diagramEdit->setText(settings.value("diagrams dir", QString()).toString());
+	QString index = settings.value("scene index", SCENE_INDEXES[0]).toString();
+	for (int i = 0 ; i < ui->sceneIndexBox->count() ; i++)
+		if (index == SCENE_INDEXES[i])
+			ui->sceneIndexBox->setCurrentIndex(i);
 }
 
 PreferencesDialog::~PreferencesDialog()
@@ -37,6 +43,7 @@ void PreferencesDialog::accept()
 	settings.setValue("source tree", srcTree);
 	settings.setValue("symbol database", ui->dbEdit->text());
 	settings.setValue("diagrams dir", diagDir);
+	settings.setValue("scene index", SCENE_INDEXES[ui->sceneIndexBox->currentIndex()]);
 	QDialog::accept();
 }
 
@@ -72,6 +72,11 @@ private:
 	 * @brief the graphical user interface generated by QtDesigner
 	 */
 	Ui::PreferencesDialog *ui;
+	/**
+	 * @brief the values of setting "scene index", in the order of the
+	 * choices in the dialog
+	 */
+	static const char* const SCENE_INDEXES[];
 };
 
 #endif // PREFERENCESDIALOG_H
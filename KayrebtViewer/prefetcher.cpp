@@ -0,0 +1,174 @@
+/**
+ * @file prefetcher.cpp
+ * @brief Implementation of class Prefetcher
+ */
+#include <stdexcept>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QSettings>
+#include <QSet>
+#include <QtGlobal>
+#if QT_VERSION >= 0x050000
+#include <QtConcurrent/QtConcurrentRun>
+#else
+#include <QtConcurrentRun>
+#endif
+#include "diagramstore.h"
+#include "dotreader.h"
+#include "graph.h"
+#include "layoutjob.h"
+#include "layoutscheduler.h"
+#include "prefetcher.h"
+
+Prefetcher& Prefetcher::instance()
+{
+	static Prefetcher* prefetcher = new Prefetcher(QCoreApplication::instance());
+	return *prefetcher;
+}
+
+Prefetcher::Prefetcher(QObject* parent) :
+	QObject(parent)
+{
+	setMemoryBudget(QSettings().value("prefetch memory", 64).toInt());
+	connect(&_parsing, SIGNAL(finished()), this, SLOT(parseFinished()));
+}
+
+int Prefetcher::getMemoryBudget() const
+{
+	return _cache.maxCost() / 1024;
+}
+
+void Prefetcher::setMemoryBudget(int megabytes)
+{
+	_cache.setMaxCost(qMax(0, megabytes) * 1024);
+}
+
+void Prefetcher::prefetch(const Graph& graph)
+{
+	_waiting.clear();
+	if (getMemoryBudget() == 0 || LayoutScheduler::instance().getMaxBackgroundWorkers() == 0)
+		return;
+
+	const DiagramData& data = graph.getData();
+	const DiagramStore& store = DiagramStore::instance();
+	QSet<QString> seen;
+	for (int v = 0 ; v < data.getNodeCount() ; v++) {
+		const QString& url = data.getNodeUrl(v);
+		if (url.isEmpty())
+			continue;
+		QString filename = store.canonicalPath(graph.resolveUrl(url));
+		if (filename.isEmpty())
+			continue; // the diagram does not exist
+		if (seen.contains(filename))
+			continue;
+		seen.insert(filename);
+		if (!_cache.contains(filename) && !_inFlight.contains(filename) && filename != _parsed)
+			_waiting.append(filename);
+	}
+	startNext();
+}
+
+bool Prefetcher::lookup(const QString& filename, DiagramData& data, GraphLayout& layout)
+{
+	const DiagramStore& store = DiagramStore::instance();
+	QString key = store.canonicalPath(filename);
+	Entry* entry = _cache.object(key);
+	if (!entry)
+		return false;
+	if (entry->modified != store.lastModified(key)) {
+		_cache.remove(key);
+		return false;
+	}
+
+	// the copies are cheap, the tables are implicitly shared
+	data = entry->data;
+	layout = entry->layout;
+	return true;
+}
+
+void Prefetcher::startNext()
+{
+	if (_parsing.isRunning() || _waiting.isEmpty())
+		return;
+	// do not parse more diagrams than the workers can lay out
+	if (_jobs.size() >= LayoutScheduler::instance().getMaxBackgroundWorkers())
+		return;
+
+	_parsed = _waiting.takeFirst();
+	_parsing.setFuture(QtConcurrent::run(&Prefetcher::parse, _parsed));
+}
+
+Prefetcher::Parse Prefetcher::parse(const QString& filename)
+{
+	Parse result;
+	result.filename = filename;
+	const DiagramStore& store = DiagramStore::instance();
+	int stored = store.find(filename);
+	if (stored >= 0) {
+		result.dot = store.readDot(stored);
+		result.laidOut = store.readLayout(stored, result.entry.layout);
+	} else {
+		QFile file(filename);
+		if (!file.open(QIODevice::ReadOnly))
+			return result;
+		result.dot = file.readAll();
+	}
+	result.entry.modified = store.lastModified(filename);
+	try {
+		result.entry.data = DotReader::read(result.dot.constData(), result.dot.size());
+		result.ok = true;
+	} catch (std::runtime_error& e) {
+		qWarning() << "Couldn't prefetch" << filename << ":" << e.what();
+	}
+	return result;
+}
+
+void Prefetcher::parseFinished()
+{
+	Parse result = _parsing.result();
+	_parsed.clear();
+	if (result.ok && result.laidOut) {
+		Entry* entry = new Entry(result.entry);
+		_cache.insert(result.filename, entry, cost(*entry));
+	} else if (result.ok) {
+		LayoutJob* job = LayoutScheduler::instance().submit(result.dot, LayoutScheduler::BACKGROUND_PRIORITY);
+		_inFlight.insert(result.filename, result.entry);
+		_jobs.insert(job, result.filename);
+		connect(job, SIGNAL(finished()), this, SLOT(layoutFinished()));
+		connect(job, SIGNAL(destroyed(QObject*)), this, SLOT(jobDestroyed(QObject*)));
+	}
+	startNext();
+}
+
+void Prefetcher::layoutFinished()
+{
+	LayoutJob* job = qobject_cast<LayoutJob*>(sender());
+	if (!job || !_jobs.contains(job))
+		return;
+
+	QString filename = _jobs.value(job);
+	Entry* entry = new Entry(_inFlight.take(filename));
+	entry->layout = job->getLayout();
+	_cache.insert(filename, entry, cost(*entry)); // deletes entry if too big
+}
+
+void Prefetcher::jobDestroyed(QObject* job)
+{
+	_inFlight.remove(_jobs.take(job));
+	startNext();
+}
+
+int Prefetcher::cost(const Entry& entry)
+{
+	// rough estimate: the tables of the diagram, its interned strings
+	// (names, URLs, file names), and the geometry and labels of the
+	// elements
+	qint64 bytes = 20 * entry.data.getNodeCount() + 12 * entry.data.getEdgeCount();
+	bytes += 64 * entry.data.getStringCount();
+	for (const NodeLayout& node : entry.layout.nodes)
+		bytes += 64 + 2 * (node.shape.size() + node.label.size());
+	for (const EdgeLayout& edge : entry.layout.edges)
+		bytes += 64 + 16 * edge.spline.size() + 2 * edge.label.size();
+	return int(bytes / 1024) + 1;
+}
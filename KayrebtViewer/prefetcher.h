@@ -0,0 +1,216 @@
+/**
+ * @file prefetcher.h
+ * @brief Definition of class Prefetcher
+ */
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QCache>
+#include <QDateTime>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include "diagramdata.h"
+#include "graphlayout.h"
+
+class Graph;
+class LayoutJob;
+
+/**
+ * @brief This class parses and lays out in advance the diagrams linked from
+ * the diagram being displayed.
+ *
+ * Once a diagram is built, the diagrams its nodes link to (through their
+ * attribute "URL") are read and parsed in a background thread, one at a time,
+ * and submitted to the LayoutScheduler with the background priority, which
+ * limits the number of workers they occupy, unless the DiagramStore has their
+ * layout already. The results are kept in memory,
+ * so that following a link displays the callee diagram immediately.
+ *
+ * The memory used by the prefetched diagrams is bounded by setting "prefetch
+ * memory" (in megabytes, 64 by default, 0 disables the prefetching), the
+ * least recently used diagrams are evicted first.
+ */
+class Prefetcher : public QObject
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * @brief Gives the unique instance of the prefetcher, creating it if
+	 * necessary.
+	 *
+	 * The instance is owned by the application object.
+	 *
+	 * @return the prefetcher
+	 */
+	static Prefetcher& instance();
+
+	/**
+	 * @brief Prefetches the diagrams linked from a diagram.
+	 *
+	 * The diagrams waiting to be prefetched for a previous diagram are
+	 * forgotten, the ones being prefetched are finished.
+	 *
+	 * @param graph the diagram whose links are to be followed
+	 */
+	void prefetch(const Graph& graph);
+	/**
+	 * @brief Gets a prefetched diagram.
+	 *
+	 * The diagram stays in the prefetcher and becomes the most recently
+	 * used one.
+	 *
+	 * @param filename the file of the diagram
+	 * @param data receives the structure and attributes of the diagram
+	 * @param layout receives the layout of the diagram
+	 *
+	 * @return true if, and only if, the diagram has been prefetched and its
+	 * file has not changed since
+	 */
+	bool lookup(const QString& filename, DiagramData& data, GraphLayout& layout);
+
+	/**
+	 * @brief Gives the maximum amount of memory used by prefetched
+	 * diagrams.
+	 *
+	 * @return the memory budget, in megabytes
+	 */
+	int getMemoryBudget() const;
+	/**
+	 * @brief Changes the maximum amount of memory used by prefetched
+	 * diagrams, evicting diagrams if necessary.
+	 *
+	 * @param megabytes the memory budget, 0 disables the prefetching
+	 */
+	void setMemoryBudget(int megabytes);
+
+private slots:
+	/**
+	 * @brief Submits the layout of a diagram once it has been parsed.
+	 *
+	 * This slot is triggered when the background parsing is over.
+	 */
+	void parseFinished();
+	/**
+	 * @brief Stores a prefetched diagram once its layout is available.
+	 */
+	void layoutFinished();
+	/**
+	 * @brief Forgets about a layout job, which has finished, failed or been
+	 * cancelled, and goes on with the next diagram.
+	 *
+	 * @param job the job being destroyed
+	 */
+	void jobDestroyed(QObject* job);
+
+private:
+	/**
+	 * @brief A prefetched diagram
+	 */
+	struct Entry
+	{
+		/**
+		 * @brief the structure and attributes of the diagram
+		 */
+		DiagramData data;
+		/**
+		 * @brief the layout of the diagram
+		 */
+		GraphLayout layout;
+		/**
+		 * @brief the modification time of the file when it was read
+		 */
+		QDateTime modified;
+	};
+
+	/**
+	 * @brief The result of the parsing of a diagram in the background
+	 */
+	struct Parse
+	{
+		/**
+		 * @brief the canonical path of the diagram file
+		 */
+		QString filename;
+		/**
+		 * @brief the parsed diagram, and its layout, not computed yet
+		 */
+		Entry entry;
+		/**
+		 * @brief the text of the diagram
+		 */
+		QByteArray dot;
+		/**
+		 * @brief whether the diagram could be read and parsed
+		 */
+		bool ok = false;
+		/**
+		 * @brief whether the layout was found in the diagram store
+		 */
+		bool laidOut = false;
+	};
+
+	/**
+	 * @brief Constructor.
+	 *
+	 * @param parent the parent object, the application
+	 */
+	explicit Prefetcher(QObject* parent = nullptr);
+
+	/**
+	 * @brief Reads and parses a diagram.
+	 *
+	 * This function runs in a background thread.
+	 *
+	 * @param filename the canonical path of the diagram file
+	 *
+	 * @return the parsed diagram
+	 */
+	static Parse parse(const QString& filename);
+	/**
+	 * @brief Gives a rough estimate of the memory used by a diagram.
+	 *
+	 * @param entry the diagram
+	 *
+	 * @return the memory used, in kilobytes, the unit of the costs in
+	 * @a _cache
+	 */
+	static int cost(const Entry& entry);
+	/**
+	 * @brief Starts parsing the next diagram waiting, if the budget allows
+	 * it.
+	 */
+	void startNext();
+
+	/**
+	 * @brief the prefetched diagrams, indexed by their canonical path
+	 */
+	QCache<QString, Entry> _cache;
+	/**
+	 * @brief the diagrams waiting to be prefetched
+	 */
+	QStringList _waiting;
+	/**
+	 * @brief the background parsing in progress
+	 */
+	QFutureWatcher<Parse> _parsing;
+	/**
+	 * @brief the canonical path of the diagram being parsed, if any
+	 */
+	QString _parsed;
+	/**
+	 * @brief the diagrams being laid out, waiting for their layout
+	 */
+	QHash<QString, Entry> _inFlight;
+	/**
+	 * @brief the layout jobs of the diagrams being laid out, with their
+	 * canonical path
+	 */
+	QHash<QObject*, QString> _jobs;
+};
+
+#endif // PREFETCHER_H
@@ -0,0 +1,103 @@
+/**
+ * @file prelayout.cpp
+ * @brief Contains the entry point of the batch pre-layout tool
+ */
+#include <cstring>
+#include <QCoreApplication>
+#include <QSettings>
+#include <QStringList>
+#include <QTextStream>
+#include <QTimer>
+#include "batchlayout.h"
+#include "diagramstore.h"
+#include "layoutscheduler.h"
+#include "layoutworker.h"
+
+namespace {
+	void usage(const QString& program)
+	{
+		QTextStream(stderr) << "Usage: " << program << " [-j WORKERS] [--pack STORE [--no-layouts]] [DIAGRAMS_DIR]" << endl
+							<< endl
+							<< "Lays out every .dot file under DIAGRAMS_DIR (by default, the diagrams" << endl
+							<< "directory configured in Kayrebt::Viewer) and stores the results in" << endl
+							<< "the layout cache of Kayrebt::Viewer." << endl
+							<< endl
+							<< "With --pack, the diagrams and their layouts are also packed in the" << endl
+							<< "diagram store STORE, which the viewer reads instead of the .dot files" << endl
+							<< "when it is named " << DiagramStore::DEFAULT_FILENAME << " and placed in the diagrams" << endl
+							<< "directory. With --no-layouts, the diagrams are packed without being" << endl
+							<< "laid out." << endl;
+	}
+}
+
+/**
+ * @fn main
+ * @brief Starts the batch pre-layout tool.
+ *
+ * This tool shares the settings of Kayrebt::Viewer, so that it fills the cache
+ * the viewer reads from. The diagrams are laid out by worker processes, which
+ * are instances of this same program started with the switch
+ * LayoutWorker::COMMAND_LINE_SWITCH.
+ *
+ * @param argc number of arguments
+ * @param argv[] the arguments
+ *
+ * @return 0 if all the diagrams were laid out, 1 if some of them could not be,
+ * 2 if the arguments are invalid
+ */
+int main(int argc, char *argv[])
+{
+	if (argc > 1 && std::strcmp(argv[1], LayoutWorker::COMMAND_LINE_SWITCH) == 0)
+		return LayoutWorker::exec();
+
+	QCoreApplication::setOrganizationName("IRISA");
+	QCoreApplication::setApplicationName("Kayrebt::Viewer");
+
+	QCoreApplication a(argc, argv);
+
+	QStringList args = a.arguments();
+	QString program = args.takeFirst();
+	QString directory = QSettings().value("diagrams dir").toString();
+	int workers = 0;
+	QString store;
+	bool withLayouts = true;
+	while (!args.isEmpty()) {
+		QString arg = args.takeFirst();
+		if (arg == "-j" && !args.isEmpty()) {
+			bool ok;
+			workers = args.takeFirst().toInt(&ok);
+			if (!ok || workers < 1) {
+				usage(program);
+				return 2;
+			}
+		} else if (arg == "--pack" && !args.isEmpty()) {
+			store = args.takeFirst();
+		} else if (arg == "--no-layouts") {
+			withLayouts = false;
+		} else if (arg == "-h" || arg == "--help" || arg.startsWith("-")) {
+			usage(program);
+			return 2;
+		} else {
+			directory = arg;
+		}
+	}
+
+	if (directory.isEmpty() || (!withLayouts && store.isEmpty())) {
+		usage(program);
+		return 2;
+	}
+
+	if (workers > 0)
+		LayoutScheduler::instance().setMaxWorkers(workers);
+
+	BatchLayout batch(directory);
+	if (!store.isEmpty() && !batch.setPack(store, withLayouts)) {
+		QTextStream(stderr) << "Couldn't write the diagram store " << store << endl;
+		return 1;
+	}
+	QObject::connect(&batch, SIGNAL(done()), &a, SLOT(quit()));
+	QTimer::singleShot(0, &batch, SLOT(start()));
+	a.exec();
+
+	return batch.getFailures() > 0 ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file progressscene.cpp
+ * @brief Implementation of class ProgressScene
+ */
+#include <QBrush>
+#include <QPushButton>
+#include "progressscene.h"
+
+namespace {
+	const char* const STAGE_NAMES[Graph::STAGE_COUNT] = {
+		QT_TRANSLATE_NOOP("ProgressScene", "Parsing the diagram"),
+		QT_TRANSLATE_NOOP("ProgressScene", "Laying out the diagram"),
+		QT_TRANSLATE_NOOP("ProgressScene", "Building the scene")
+	};
+}
+
+ProgressScene::ProgressScene(Graph* graph, QObject* parent) :
+	QGraphicsScene(parent),
+	_graph(graph)
+{
+	setBackgroundBrush(QBrush(Qt::gray));
+	addText(tr("Graph in construction, a moment please..."));
+
+	for (int stage = 0 ; stage < Graph::STAGE_COUNT ; stage++) {
+		_lines[stage] = addText(QString());
+		_lines[stage]->setPos(0, 30 + 20 * stage);
+		_states[stage] = PENDING;
+		_times[stage] = -1;
+	}
+
+	// the parsing is done by the time the drawing is shown, the layout
+	// is waiting for a worker
+	_states[Graph::PARSE_STAGE] = DONE;
+	_times[Graph::PARSE_STAGE] = _graph->getStageTime(Graph::PARSE_STAGE);
+	for (int stage = 0 ; stage < Graph::STAGE_COUNT ; stage++)
+		updateLine(stage);
+	_elapsed.start();
+
+	QPushButton* cancelButton = new QPushButton(tr("Cancel"));
+	_cancel = addWidget(cancelButton);
+	_cancel->setPos(0, 40 + 20 * Graph::STAGE_COUNT);
+	connect(cancelButton, SIGNAL(clicked()), _graph, SLOT(cancel()));
+
+	connect(_graph, SIGNAL(stageStarted(int)), this, SLOT(stageStarted(int)));
+	connect(_graph, SIGNAL(stageFinished(int,qint64)), this, SLOT(stageFinished(int,qint64)));
+	connect(_graph, SIGNAL(graphFailed(QString)), this, SLOT(showError(QString)));
+	connect(&_ticker, SIGNAL(timeout()), this, SLOT(refresh()));
+	_ticker.start(100);
+}
+
+void ProgressScene::stageStarted(int stage)
+{
+	_states[stage] = RUNNING;
+	_elapsed.restart();
+	updateLine(stage);
+}
+
+void ProgressScene::stageFinished(int stage, qint64 milliseconds)
+{
+	_states[stage] = DONE;
+	_times[stage] = milliseconds;
+	_elapsed.restart();
+	updateLine(stage);
+	if (stage == Graph::LAYOUT_STAGE)
+		_cancel->hide(); // the rest happens in one go
+}
+
+void ProgressScene::refresh()
+{
+	for (int stage = 0 ; stage < Graph::STAGE_COUNT ; stage++)
+		if (_states[stage] == RUNNING ||
+			(stage == Graph::LAYOUT_STAGE && _states[stage] == PENDING))
+			updateLine(stage);
+}
+
+void ProgressScene::updateLine(int stage)
+{
+	QString name = tr(STAGE_NAMES[stage]);
+	QString seconds = QString::number(_elapsed.isValid() ? _elapsed.elapsed() / 1000.0 : 0.0, 'f', 1);
+	QString text;
+	switch (_states[stage]) {
+		case PENDING:
+			if (stage == Graph::LAYOUT_STAGE)
+				text = tr("%1: waiting for a layout worker (%2 s)").arg(name).arg(seconds);
+			else
+				text = tr("%1").arg(name);
+			break;
+		case RUNNING:
+			text = tr("%1... (%2 s)").arg(name).arg(seconds);
+			break;
+		case DONE:
+			if (stage == Graph::LAYOUT_STAGE && _graph->isLayoutCoarse())
+				text = tr("%1: coarse layout done in %2 ms, GraphViz will refine it").arg(name).arg(_times[stage]);
+			else if (stage == Graph::LAYOUT_STAGE && _graph->isLayoutFromCache())
+				text = tr("%1: found in the cache in %2 ms").arg(name).arg(_times[stage]);
+			else
+				text = tr("%1: done in %2 ms").arg(name).arg(_times[stage]);
+			break;
+	}
+	_lines[stage]->setPlainText(text);
+}
+
+void ProgressScene::showError(const QString& error)
+{
+	_ticker.stop();
+	_cancel->hide();
+	QGraphicsTextItem* text = addText(tr("This diagram cannot be displayed:\n%1").arg(error));
+	text->setDefaultTextColor(Qt::darkRed);
+	text->setPos(0, 40 + 20 * Graph::STAGE_COUNT);
+}
@@ -0,0 +1,114 @@
+/**
+ * @file progressscene.h
+ * @brief Definition of class ProgressScene
+ */
+#ifndef PROGRESSSCENE_H
+#define PROGRESSSCENE_H
+
+#include <QGraphicsScene>
+#include <QGraphicsTextItem>
+#include <QGraphicsProxyWidget>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "graph.h"
+
+/**
+ * @brief This class is the scene displayed in a Drawing while its diagram is
+ * being built.
+ *
+ * It shows the stages of the construction of the diagram (parsing, layout and
+ * creation of the scene), the time spent in each one, and lets the user
+ * cancel the construction. If the construction fails, the reason is displayed
+ * instead.
+ */
+class ProgressScene : public QGraphicsScene
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * @brief Constructor.
+	 *
+	 * The scene follows the progress of @p graph through its signals.
+	 *
+	 * @param graph the diagram being built
+	 * @param parent the parent object
+	 */
+	explicit ProgressScene(Graph* graph, QObject* parent = nullptr);
+
+public slots:
+	/**
+	 * @brief Marks a stage as running.
+	 *
+	 * @param stage the Graph::Stage which has begun
+	 */
+	void stageStarted(int stage);
+	/**
+	 * @brief Marks a stage as done.
+	 *
+	 * @param stage the Graph::Stage which has ended
+	 * @param milliseconds the duration of the stage
+	 */
+	void stageFinished(int stage, qint64 milliseconds);
+	/**
+	 * @brief Displays the reason why the diagram cannot be shown.
+	 *
+	 * @param error the reason of the failure
+	 */
+	void showError(const QString& error);
+
+private slots:
+	/**
+	 * @brief Updates the text of the running stage with the time elapsed.
+	 */
+	void refresh();
+
+private:
+	/**
+	 * @brief The states a stage can be in.
+	 */
+	enum StageState {
+		PENDING,
+		RUNNING,
+		DONE
+	};
+
+	/**
+	 * @brief Updates the text of a stage according to its state.
+	 *
+	 * @param stage the stage to update
+	 */
+	void updateLine(int stage);
+
+	/**
+	 * @brief the diagram being built
+	 */
+	Graph* _graph;
+	/**
+	 * @brief the line of text of each stage
+	 */
+	QGraphicsTextItem* _lines[Graph::STAGE_COUNT];
+	/**
+	 * @brief the state of each stage
+	 */
+	StageState _states[Graph::STAGE_COUNT];
+	/**
+	 * @brief the duration of each stage which is over
+	 */
+	qint64 _times[Graph::STAGE_COUNT];
+	/**
+	 * @brief the time elapsed since the current stage began, or since
+	 * the layout was requested while it is waiting for a worker
+	 */
+	QElapsedTimer _elapsed;
+	/**
+	 * @brief the timer refreshing the running stage
+	 */
+	QTimer _ticker;
+	/**
+	 * @brief the button to cancel the construction
+	 */
+	QGraphicsProxyWidget* _cancel;
+};
+
+#endif // PROGRESSSCENE_H
@@ -0,0 +1,136 @@
+/**
+ * @file scenegeometry.cpp
+ * @brief Implementation of class SceneGeometry
+ */
+#include <QStringList>
+#include <qmath.h>
+#include "scenegeometry.h"
+
+const qreal SceneGeometry::ARROW_LENGTH = 15;
+const qreal SceneGeometry::ARROW_ANGLE = 0.3;
+
+SceneGeometry SceneGeometry::compute(const GraphLayout& layout, const QSizeF& charSize)
+{
+	SceneGeometry geometry;
+	geometry.sceneRect = layout.boundingBox;
+	geometry.nodes.reserve(layout.nodes.size());
+	for (const NodeLayout& node : layout.nodes)
+		geometry.nodes.append(computeNode(node, charSize));
+	geometry.edges.reserve(layout.edges.size());
+	for (const EdgeLayout& edge : layout.edges)
+		geometry.edges.append(computeEdge(edge, charSize));
+	return geometry;
+}
+
+NodeGeometry SceneGeometry::computeNode(const NodeLayout& node, const QSizeF& charSize)
+{
+	NodeGeometry geometry;
+	QRectF box(node.center - QPointF(node.size.width()/2, node.size.height()/2), node.size);
+
+	if (node.shape == "rect") {
+		geometry.outline.addRect(box);
+	} else if (node.shape == "diamond") {
+		QPointF top(node.center - QPointF(0, node.size.height()/2));
+		QPointF left(node.center - QPointF(node.size.width()/2, 0));
+		QPointF bottom(node.center + QPointF(0, node.size.height()/2));
+		QPointF right(node.center + QPointF(node.size.width()/2, 0));
+
+		geometry.outline.moveTo(top);
+		geometry.outline.lineTo(left);
+		geometry.outline.lineTo(bottom);
+		geometry.outline.lineTo(right);
+		geometry.outline.lineTo(top);
+	} else { // by default: ellipse
+		geometry.outline.addEllipse(box);
+	}
+
+	if (!node.label.isEmpty()) {
+		geometry.label = node.label;
+		geometry.label.replace("\\n","\n");
+		QSizeF text = textSize(geometry.label, charSize);
+		geometry.labelRect = QRectF(box.topLeft() + QPointF((box.width() - text.width()) / 2,
+															(box.height() - text.height()) / 2),
+									text);
+	}
+	return geometry;
+}
+
+bool SceneGeometry::nodeContains(const NodeLayout& node, const QPointF& point)
+{
+	if (node.size.isEmpty())
+		return false;
+	// distances relative to the half-sizes of the node
+	qreal dx = qAbs(point.x() - node.center.x()) / (node.size.width() / 2);
+	qreal dy = qAbs(point.y() - node.center.y()) / (node.size.height() / 2);
+	if (node.shape == "rect")
+		return dx <= 1 && dy <= 1;
+	else if (node.shape == "diamond")
+		return dx + dy <= 1;
+	else // by default: ellipse
+		return dx * dx + dy * dy <= 1;
+}
+
+EdgeGeometry SceneGeometry::computeEdge(const EdgeLayout& edge, const QSizeF& charSize)
+{
+	EdgeGeometry geometry;
+	QPainterPath& path = geometry.path;
+
+	// -----BEGIN SHAMELESSLY COPY-PASTED CODE-----
+	// Inspired by code from
+	//     http://www.mupuf.org/blog/2010/07/08/
+	//           how_to_use_graphviz_to_draw_graphs_in_a_qt_graphics_scene/
+	//    © Steve D. Lazaro, 07/2010
+	//
+	//Calculate the path from the spline
+	const QVector<QPointF>& spline = edge.spline;
+	if (spline.size()%3 == 1)
+	{
+		//If there is a starting point, draw a line from it to the first curve point
+		if(edge.hasStart)
+		{
+			path.moveTo(edge.start);
+			path.lineTo(spline[0]);
+			geometry.polyline << edge.start;
+		}
+		else
+			path.moveTo(spline[0]);
+		geometry.polyline << spline[0];
+
+		//Loop over the curve points
+		for(int i=1; i<spline.size(); i+=3) {
+			path.cubicTo(spline[i], spline[i+1], spline[i+2]);
+			geometry.polyline << spline[i+2];
+		}
+
+		//If there is an ending point, draw a line to it
+		if(edge.hasEnd) {
+			path.lineTo(edge.end);
+			geometry.polyline << edge.end;
+		}
+
+		// draw the arrow
+		QPointF cur(path.currentPosition());
+		qreal angleRad = (180.0f - path.angleAtPercent(1)) * 3.14159265358979 / 180.0f;
+
+		geometry.arrowHead << cur
+			<< cur + QPointF(ARROW_LENGTH * qCos(angleRad-ARROW_ANGLE), ARROW_LENGTH * qSin(angleRad-ARROW_ANGLE))
+			<< cur + QPointF(ARROW_LENGTH * qCos(angleRad+ARROW_ANGLE), ARROW_LENGTH * qSin(angleRad+ARROW_ANGLE))
+			<< cur;
+	}
+	// -----END SHAMELESSLY COPY-PASTED CODE-----
+
+	geometry.label = edge.label;
+	if (!geometry.label.isEmpty())
+		geometry.labelRect = QRectF(edge.labelPos, textSize(geometry.label, charSize));
+	return geometry;
+}
+
+QSizeF SceneGeometry::textSize(const QString& label, const QSizeF& charSize)
+{
+	// the font is a monospace one, the text is as wide as its longest line
+	QStringList lines = label.split('\n');
+	int columns = 0;
+	for (const QString& line : lines)
+		columns = qMax(columns, line.size());
+	return QSizeF(columns * charSize.width(), lines.size() * charSize.height());
+}
@@ -0,0 +1,163 @@
+/**
+ * @file scenegeometry.h
+ * @brief Definition of class SceneGeometry
+ */
+#ifndef SCENEGEOMETRY_H
+#define SCENEGEOMETRY_H
+
+#include <QPainterPath>
+#include <QPointF>
+#include <QPolygonF>
+#include <QRectF>
+#include <QSizeF>
+#include <QString>
+#include <QVector>
+#include "graphlayout.h"
+
+/**
+ * @brief The shapes of a node, ready to be drawn.
+ *
+ * All coordinates are expressed in the diagram scene coordinates.
+ */
+struct NodeGeometry
+{
+	/**
+	 * @brief the outline of the node
+	 */
+	QPainterPath outline;
+	/**
+	 * @brief the text of the node, one line per line of text, possibly
+	 * empty
+	 */
+	QString label;
+	/**
+	 * @brief the rectangle occupied by the text, centered in the node
+	 */
+	QRectF labelRect;
+};
+
+/**
+ * @brief The shapes of an edge, ready to be drawn.
+ *
+ * All coordinates are expressed in the diagram scene coordinates.
+ */
+struct EdgeGeometry
+{
+	/**
+	 * @brief the line of the edge, as a sequence of cubic curves
+	 */
+	QPainterPath path;
+	/**
+	 * @brief the ends of the curves of the line, to draw it roughly when
+	 * the diagram is zoomed out
+	 */
+	QPolygonF polyline;
+	/**
+	 * @brief the head of the arrow, empty if the edge has no valid spline
+	 */
+	QPolygonF arrowHead;
+	/**
+	 * @brief the text of the edge, possibly empty
+	 */
+	QString label;
+	/**
+	 * @brief the rectangle occupied by the text
+	 */
+	QRectF labelRect;
+};
+
+/**
+ * @brief This class holds everything needed to populate the scene of a
+ * diagram: the paths, polygons and texts of all its elements, and the scene
+ * rectangle.
+ *
+ * Converting the splines to painter paths, computing the arrow heads and
+ * placing the labels takes a long time for big diagrams, it is done by
+ * compute() in a background thread, so that the GUI thread only has to create
+ * the items. The labels are measured with the size of a character of the
+ * monospace font, which is given by the GUI thread, fonts being better left
+ * alone outside of it.
+ *
+ * Nodes and edges are indexed as in the GraphLayout they are computed from.
+ */
+class SceneGeometry
+{
+public:
+	/**
+	 * @brief the length of the sides of arrow heads
+	 */
+	static const qreal ARROW_LENGTH;
+	/**
+	 * @brief the half-angle at the tip of arrow heads, in radians
+	 */
+	static const qreal ARROW_ANGLE;
+
+	/**
+	 * @brief Computes the shapes of all the elements of a diagram.
+	 *
+	 * This function does not use any font or widget, and can be called
+	 * from any thread.
+	 *
+	 * @param layout the layout of the diagram
+	 * @param charSize the width of a character and the height of a line of
+	 * text in the labels, in scene coordinates
+	 *
+	 * @return the geometry of the diagram
+	 */
+	static SceneGeometry compute(const GraphLayout& layout, const QSizeF& charSize);
+	/**
+	 * @brief Computes the shapes of a node.
+	 *
+	 * @param node the layout of the node
+	 * @param charSize the size of a character of the label
+	 *
+	 * @return the geometry of the node
+	 */
+	static NodeGeometry computeNode(const NodeLayout& node, const QSizeF& charSize);
+	/**
+	 * @brief Tells whether a point is inside the outline of a node.
+	 *
+	 * The test is made on the layout, without computing the outline.
+	 *
+	 * @param node the layout of the node
+	 * @param point a point, in scene coordinates
+	 *
+	 * @return true if, and only if, the point is inside the node
+	 */
+	static bool nodeContains(const NodeLayout& node, const QPointF& point);
+	/**
+	 * @brief Computes the shapes of an edge.
+	 *
+	 * @param edge the layout of the edge
+	 * @param charSize the size of a character of the label
+	 *
+	 * @return the geometry of the edge
+	 */
+	static EdgeGeometry computeEdge(const EdgeLayout& edge, const QSizeF& charSize);
+
+	/**
+	 * @brief the scene rectangle of the diagram
+	 */
+	QRectF sceneRect;
+	/**
+	 * @brief the geometry of the nodes
+	 */
+	QVector<NodeGeometry> nodes;
+	/**
+	 * @brief the geometry of the edges
+	 */
+	QVector<EdgeGeometry> edges;
+
+private:
+	/**
+	 * @brief Measures a label.
+	 *
+	 * @param label the text of the label, one line per line of text
+	 * @param charSize the size of a character of the label
+	 *
+	 * @return the size of the text
+	 */
+	static QSizeF textSize(const QString& label, const QSizeF& charSize);
+};
+
+#endif // SCENEGEOMETRY_H
@@ -0,0 +1,63 @@
+/**
+ * @file scenesnapshot.cpp
+ * @brief Implementation of class SceneSnapshot
+ */
+#include <algorithm>
+#include <QPainter>
+#include <QVector>
+#include "scenesnapshot.h"
+#include "scenegeometry.h"
+#include "graph.h"
+#include "node.h"
+#include "edge.h"
+
+const qreal SceneSnapshot::MARGIN = 4;
+
+SceneSnapshot SceneSnapshot::take(const Graph& graph)
+{
+	SceneSnapshot snapshot;
+	snapshot.layout = graph.getLayout();
+	snapshot.nodeIndex = graph.getNodeIndex();
+	snapshot.edgeIndex = graph.getEdgeIndex();
+	graph.getStates(snapshot.hiddenNodes, snapshot.highlightedNodes,
+					snapshot.hiddenEdges, snapshot.highlightedEdges);
+	snapshot.charSize = graph.getCharSize();
+	snapshot.labelThreshold = graph.getLabelDetailThreshold();
+	snapshot.shapeThreshold = graph.getShapeDetailThreshold();
+	return snapshot;
+}
+
+QImage SceneSnapshot::render(const SceneSnapshot& snapshot, const QRectF& area, const QSize& size)
+{
+	QImage image(size, QImage::Format_ARGB32_Premultiplied);
+	image.fill(0);
+	if (area.isEmpty())
+		return image;
+	QPainter painter(&image);
+	painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing);
+	painter.scale(size.width() / area.width(), size.height() / area.height());
+	painter.translate(-area.topLeft());
+
+	// the pens overflow the bounding rectangles of the elements a little,
+	// the elements are painted in the order they are created in the scene
+	QRectF margin = area.adjusted(-MARGIN, -MARGIN, MARGIN, MARGIN);
+	QVector<int> found;
+	snapshot.edgeIndex.query(margin, found);
+	std::sort(found.begin(), found.end());
+	for (int e : found) {
+		if (snapshot.hiddenEdges.testBit(e))
+			continue;
+		Edge::paintEdge(&painter, SceneGeometry::computeEdge(snapshot.layout.edges[e], snapshot.charSize),
+						snapshot.highlightedEdges.testBit(e), snapshot.labelThreshold, snapshot.shapeThreshold);
+	}
+	found.clear();
+	snapshot.nodeIndex.query(margin, found);
+	std::sort(found.begin(), found.end());
+	for (int v : found) {
+		if (snapshot.hiddenNodes.testBit(v))
+			continue;
+		Node::paintNode(&painter, SceneGeometry::computeNode(snapshot.layout.nodes[v], snapshot.charSize),
+						snapshot.highlightedNodes.testBit(v), snapshot.labelThreshold, snapshot.shapeThreshold);
+	}
+	return image;
+}
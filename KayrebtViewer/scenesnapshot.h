@@ -0,0 +1,101 @@
+/**
+ * @file scenesnapshot.h
+ * @brief Definition of class SceneSnapshot
+ */
+#ifndef SCENESNAPSHOT_H
+#define SCENESNAPSHOT_H
+
+#include <QBitArray>
+#include <QImage>
+#include <QRectF>
+#include <QSize>
+#include <QSizeF>
+#include "graphlayout.h"
+#include "gridindex.h"
+
+class Graph;
+
+/**
+ * @brief This class holds everything needed to render a diagram away from
+ * its items: the layout, the index of the elements and their state.
+ *
+ * The items of a Graph belong to the GUI thread, and in a virtual scene most
+ * elements have none. A snapshot is taken in the GUI thread, cheaply since
+ * its content is implicitly shared with the Graph, and can then be rendered
+ * in background threads, the geometry of the elements being computed on the
+ * fly.
+ */
+class SceneSnapshot
+{
+public:
+	/**
+	 * @brief Takes a snapshot of a diagram.
+	 *
+	 * @param graph the diagram, which must be built
+	 *
+	 * @return the snapshot
+	 */
+	static SceneSnapshot take(const Graph& graph);
+	/**
+	 * @brief Renders a part of a diagram.
+	 *
+	 * This function does not use any item or widget, and can be called
+	 * from any thread. The background of the image is transparent.
+	 *
+	 * @param snapshot the diagram
+	 * @param area the part of the scene to render
+	 * @param size the size of the image, @p area is scaled to fit in it
+	 *
+	 * @return the image
+	 */
+	static QImage render(const SceneSnapshot& snapshot, const QRectF& area, const QSize& size);
+
+	/**
+	 * @brief how far the pens may overflow the bounding rectangle of an
+	 * element, in scene coordinates
+	 */
+	static const qreal MARGIN;
+
+	/**
+	 * @brief the layout of the diagram
+	 */
+	GraphLayout layout;
+	/**
+	 * @brief the index of the nodes
+	 */
+	GridIndex nodeIndex;
+	/**
+	 * @brief the index of the edges
+	 */
+	GridIndex edgeIndex;
+	/**
+	 * @brief whether each node is hidden
+	 */
+	QBitArray hiddenNodes;
+	/**
+	 * @brief whether each node is highlighted
+	 */
+	QBitArray highlightedNodes;
+	/**
+	 * @brief whether each edge is hidden
+	 */
+	QBitArray hiddenEdges;
+	/**
+	 * @brief whether each edge is highlighted
+	 */
+	QBitArray highlightedEdges;
+	/**
+	 * @brief the size of a character of the labels
+	 */
+	QSizeF charSize;
+	/**
+	 * @brief the level of detail under which labels are not drawn
+	 */
+	qreal labelThreshold = 0;
+	/**
+	 * @brief the level of detail under which the elements are simplified
+	 */
+	qreal shapeThreshold = 0;
+};
+
+#endif // SCENESNAPSHOT_H
@@ -0,0 +1,111 @@
+/**
+ * @file stringpool.cpp
+ * @brief Implementation of class StringPool
+ */
+#include "stringpool.h"
+
+StringPool::StringPool() :
+	_slots(16, -1)
+{
+	// the empty string is never looked up, it is not in the table
+	_strings.append(QString());
+}
+
+int StringPool::intern(const char* data, int length)
+{
+	if (length == 0)
+		return 0;
+	for (int i = 0 ; i < length ; i++)
+		if (uchar(data[i]) >= 0x80)
+			return internString(QString::fromUtf8(data, length));
+	return internAscii(data, length);
+}
+
+int StringPool::intern(const QString& string)
+{
+	if (string.isEmpty())
+		return 0;
+	return internString(string);
+}
+
+int StringPool::internString(const QString& string)
+{
+	uint mask = _slots.size() - 1;
+	for (uint slot = hash(string) & mask ; ; slot = (slot + 1) & mask) {
+		int id = _slots[slot];
+		if (id < 0)
+			return add(string, slot);
+		if (_strings[id] == string)
+			return id;
+	}
+}
+
+int StringPool::internAscii(const char* data, int length)
+{
+	uint mask = _slots.size() - 1;
+	for (uint slot = hash(data, length) & mask ; ; slot = (slot + 1) & mask) {
+		int id = _slots[slot];
+		if (id < 0)
+			return add(QString::fromLatin1(data, length), slot);
+
+		// compared without converting the characters
+		const QString& candidate = _strings[id];
+		if (candidate.size() != length)
+			continue;
+		const QChar* units = candidate.constData();
+		int i = 0;
+		while (i < length && units[i].unicode() == ushort(data[i]))
+			i++;
+		if (i == length)
+			return id;
+	}
+}
+
+int StringPool::add(const QString& string, int slot)
+{
+	int id = _strings.size();
+	_strings.append(string);
+	_slots[slot] = id;
+
+	// at most half full, so that the probe sequences stay short
+	if (2 * _strings.size() > _slots.size()) {
+		QVector<int> slots(2 * _slots.size(), -1);
+		uint mask = slots.size() - 1;
+		for (int other = 1 ; other < _strings.size() ; other++) {
+			uint s = hash(_strings[other]) & mask;
+			while (slots[s] >= 0)
+				s = (s + 1) & mask;
+			slots[s] = other;
+		}
+		_slots.swap(slots);
+	}
+	return id;
+}
+
+uint StringPool::hash(const QString& string)
+{
+	// FNV-1a over the code units
+	uint h = 2166136261u;
+	const QChar* units = string.constData();
+	for (int i = 0 ; i < string.size() ; i++)
+		h = (h ^ units[i].unicode()) * 16777619u;
+	return h;
+}
+
+uint StringPool::hash(const char* data, int length)
+{
+	uint h = 2166136261u;
+	for (int i = 0 ; i < length ; i++)
+		h = (h ^ uchar(data[i])) * 16777619u;
+	return h;
+}
+
+const QString& StringPool::get(int id) const
+{
+	return _strings[id];
+}
+
+int StringPool::size() const
+{
+	return _strings.size();
+}
@@ -0,0 +1,120 @@
+/**
+ * @file stringpool.h
+ * @brief Definition of class StringPool
+ */
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief This class stores strings once and identifies them by integers.
+ *
+ * Diagrams repeat the same strings a lot (file names, URLs, attribute
+ * values), storing them in a pool saves memory and turns string comparisons
+ * into integer comparisons. The identifier 0 always stands for the empty
+ * string.
+ */
+class StringPool
+{
+public:
+	/**
+	 * @brief Constructs a pool containing only the empty string.
+	 */
+	StringPool();
+
+	/**
+	 * @brief Adds a string to the pool if it is not in it yet.
+	 *
+	 * @param data the UTF-8 characters of the string
+	 * @param length the number of bytes in @p data
+	 *
+	 * @return the identifier of the string
+	 */
+	int intern(const char* data, int length);
+	/**
+	 * @brief Adds a string to the pool if it is not in it yet.
+	 *
+	 * @param string the string
+	 *
+	 * @return the identifier of the string
+	 */
+	int intern(const QString& string);
+	/**
+	 * @brief Gives the string corresponding to an identifier.
+	 *
+	 * @param id the identifier of the string, as given by intern()
+	 *
+	 * @return the string
+	 */
+	const QString& get(int id) const;
+	/**
+	 * @brief Gives the number of distinct strings in the pool.
+	 *
+	 * @return the size of the pool
+	 */
+	int size() const;
+
+private:
+	/**
+	 * @brief Finds a string in the pool, or adds it.
+	 *
+	 * @param string the string, not empty
+	 *
+	 * @return the identifier of the string
+	 */
+	int internString(const QString& string);
+	/**
+	 * @brief Finds an ASCII string in the pool, or adds it, without
+	 * converting it unless it is new.
+	 *
+	 * @param data the characters of the string, all ASCII
+	 * @param length the number of characters
+	 *
+	 * @return the identifier of the string
+	 */
+	int internAscii(const char* data, int length);
+	/**
+	 * @brief Adds a new string to the pool.
+	 *
+	 * @param string the string
+	 * @param slot the free slot of @a _slots where the string goes
+	 *
+	 * @return the identifier of the string
+	 */
+	int add(const QString& string, int slot);
+	/**
+	 * @brief Hashes a string.
+	 *
+	 * @param string the string
+	 *
+	 * @return the hash of the UTF-16 code units of @p string
+	 */
+	static uint hash(const QString& string);
+	/**
+	 * @brief Hashes an ASCII string, as hash(const QString&) does the
+	 * same string converted.
+	 *
+	 * @param data the characters of the string, all ASCII
+	 * @param length the number of characters
+	 *
+	 * @return the hash of the string
+	 */
+	static uint hash(const char* data, int length);
+
+	/**
+	 * @brief the strings, indexed by their identifiers
+	 */
+	QVector<QString> _strings;
+	/**
+	 * @brief a hash table of the identifiers of the strings, by open
+	 * addressing, -1 marking the free slots
+	 *
+	 * The strings themselves are only stored in @a _strings. The size of
+	 * the table is a power of two, at least twice the number of strings.
+	 */
+	QVector<int> _slots;
+};
+
+#endif // STRINGPOOL_H
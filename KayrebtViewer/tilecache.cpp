@@ -0,0 +1,145 @@
+/**
+ * @file tilecache.cpp
+ * @brief Implementation of class TileCache
+ */
+#include <QPainter>
+#include <QThread>
+#include <qmath.h>
+#include <QtCore>
+#if QT_VERSION >= 0x050000
+#include <QtConcurrent/QtConcurrentRun>
+#else
+#include <QtConcurrentRun>
+#endif
+#include "tilecache.h"
+#include "graph.h"
+
+/**
+ * @brief the number of steps per unit in which the scales are rounded, so
+ * that the tiles of a scale are found again
+ */
+static const qint64 SCALE_PRECISION = 1 << 16;
+
+TileCache::TileCache(const Graph* graph, int memory, QObject* parent) :
+	QObject(parent),
+	_graph(graph),
+	_tiles(memory)
+{
+}
+
+TileCache::~TileCache()
+{
+	for (QFutureWatcher<QImage>* watcher : _requests.keys())
+		watcher->waitForFinished();
+}
+
+QRectF TileCache::area(const Key& key)
+{
+	qreal size = TILE_SIZE * qreal(SCALE_PRECISION) / key.first;
+	int x = int(quint32(key.second >> 32));
+	int y = int(quint32(key.second));
+	return QRectF(x * size, y * size, size, size);
+}
+
+bool TileCache::paint(QPainter* painter, const QTransform& transform, const QRect& exposed)
+{
+	if (transform.type() > QTransform::TxScale || transform.m11() <= 0)
+		return false;
+	qint64 level = qRound64(transform.m11() * SCALE_PRECISION);
+	qreal size = TILE_SIZE * qreal(SCALE_PRECISION) / level;
+	QRectF shown = transform.inverted().mapRect(QRectF(exposed));
+	int left = qFloor(shown.left() / size);
+	int right = qFloor(shown.right() / size);
+	int top = qFloor(shown.top() / size);
+	int bottom = qFloor(shown.bottom() / size);
+
+	// the tiles shown are rendered a few at a time, so that those of a
+	// scale zoomed past are soon out of the way
+	int maxPending = 2 * QThread::idealThreadCount();
+	bool complete = true;
+	for (int y = top ; y <= bottom ; y++) {
+		for (int x = left ; x <= right ; x++) {
+			Key key(level, (quint64(quint32(x)) << 32) | quint32(y));
+			if (_tiles.contains(key))
+				continue;
+			complete = false;
+			if (!_pending.contains(key) && _pending.size() < maxPending)
+				request(key);
+		}
+	}
+	if (!complete)
+		return false;
+
+	for (int y = top ; y <= bottom ; y++) {
+		for (int x = left ; x <= right ; x++) {
+			Key key(level, (quint64(quint32(x)) << 32) | quint32(y));
+			QPointF corner = transform.map(QPointF(x * size, y * size));
+			painter->drawImage(QPoint(qRound(corner.x()), qRound(corner.y())), *_tiles.object(key));
+		}
+	}
+	return true;
+}
+
+void TileCache::request(const Key& key)
+{
+	if (_snapshotDirty) {
+		_snapshot = SceneSnapshot::take(*_graph);
+		_snapshotDirty = false;
+	}
+
+	Request request;
+	request.key = key;
+	request.area = area(key);
+	request.stale = false;
+	QFutureWatcher<QImage>* watcher = new QFutureWatcher<QImage>(this);
+	connect(watcher, SIGNAL(finished()), this, SLOT(tileRendered()));
+	_requests.insert(watcher, request);
+	_pending.insert(key);
+	watcher->setFuture(QtConcurrent::run(&SceneSnapshot::render, _snapshot, request.area,
+										 QSize(TILE_SIZE, TILE_SIZE)));
+}
+
+void TileCache::tileRendered()
+{
+	QFutureWatcher<QImage>* watcher = static_cast<QFutureWatcher<QImage>*>(sender());
+	Request request = _requests.take(watcher);
+	_pending.remove(request.key);
+	if (!request.stale) {
+		QImage* tile = new QImage(watcher->result());
+		_tiles.insert(request.key, tile, tile->byteCount());
+	}
+	watcher->deleteLater();
+	emit tilesChanged();
+}
+
+void TileCache::invalidate(const QVector<QRectF>& areas)
+{
+	const qreal margin = SceneSnapshot::MARGIN;
+	for (const Key& key : _tiles.keys()) {
+		QRectF tile = area(key).adjusted(-margin, -margin, margin, margin);
+		for (const QRectF& changed : areas) {
+			if (tile.intersects(changed)) {
+				_tiles.remove(key);
+				break;
+			}
+		}
+	}
+	for (Request& request : _requests) {
+		QRectF tile = request.area.adjusted(-margin, -margin, margin, margin);
+		for (const QRectF& changed : areas) {
+			if (tile.intersects(changed)) {
+				request.stale = true;
+				break;
+			}
+		}
+	}
+	_snapshotDirty = true;
+}
+
+void TileCache::clear()
+{
+	_tiles.clear();
+	for (Request& request : _requests)
+		request.stale = true;
+	_snapshotDirty = true;
+}
@@ -0,0 +1,170 @@
+/**
+ * @file tilecache.h
+ * @brief Definition of class TileCache
+ */
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QPair>
+#include <QRect>
+#include <QRectF>
+#include <QSet>
+#include <QTransform>
+#include <QVector>
+#include "scenesnapshot.h"
+
+class Graph;
+class QPainter;
+
+/**
+ * @brief This class keeps the diagram rendered in images, so that the view
+ * can be repainted without painting every item again.
+ *
+ * The scene is cut in square tiles of TILE_SIZE pixels at the scale of the
+ * view, each tile being rendered in a background thread from a SceneSnapshot,
+ * not from the items, which belong to the GUI thread. The tiles of all the scales used recently are
+ * kept, up to the memory given by setting "tile cache" (in megabytes, 0, the
+ * default, disables the cache).
+ *
+ * When elements are highlighted or hidden, only the tiles they overlap are
+ * rendered again. When the layout changes, all the tiles are.
+ */
+class TileCache : public QObject
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * @brief Constructor.
+	 *
+	 * @param graph the diagram to render
+	 * @param memory the maximum size of the tiles kept, in bytes
+	 * @param parent the parent object
+	 */
+	TileCache(const Graph* graph, int memory, QObject* parent = nullptr);
+	/**
+	 * @brief Destroys the cache, waiting for the tiles being rendered.
+	 */
+	~TileCache();
+
+	/**
+	 * @brief Paints the part of the diagram in a view, if all its tiles
+	 * are ready.
+	 *
+	 * Otherwise, nothing is painted and the tiles missing are rendered
+	 * in the background, tilesChanged() is emitted when they are ready.
+	 *
+	 * @param painter the painter of the viewport
+	 * @param transform the transformation from scene to viewport
+	 * coordinates, a scale and a translation
+	 * @param exposed the part of the viewport to repaint
+	 *
+	 * @return true if, and only if, the tiles have been painted
+	 */
+	bool paint(QPainter* painter, const QTransform& transform, const QRect& exposed);
+
+	/**
+	 * @brief the width and height of a tile, in pixels
+	 */
+	static const int TILE_SIZE = 256;
+
+public slots:
+	/**
+	 * @brief Forgets all the tiles, at all scales.
+	 */
+	void clear();
+	/**
+	 * @brief Forgets the tiles overlapping some areas of the diagram, at
+	 * all scales.
+	 *
+	 * @param areas the areas of interest, in scene coordinates
+	 */
+	void invalidate(const QVector<QRectF>& areas);
+
+signals:
+	/**
+	 * @brief This signal is emitted when a tile has been rendered, or
+	 * could not be because the diagram changed in the meantime.
+	 */
+	void tilesChanged();
+
+private slots:
+	/**
+	 * @brief When this slot is triggered, a tile has been rendered in
+	 * the background.
+	 */
+	void tileRendered();
+
+private:
+	/**
+	 * @brief A tile, identified by its scale and its position in the grid
+	 * of tiles at that scale
+	 */
+	typedef QPair<qint64,quint64> Key;
+	/**
+	 * @brief A tile being rendered
+	 */
+	struct Request
+	{
+		/**
+		 * @brief the tile
+		 */
+		Key key;
+		/**
+		 * @brief the part of the scene rendered
+		 */
+		QRectF area;
+		/**
+		 * @brief whether the diagram has changed in the area since the
+		 * snapshot was taken
+		 */
+		bool stale;
+	};
+
+	/**
+	 * @brief Gives the part of the scene covered by a tile.
+	 *
+	 * @param key the tile
+	 *
+	 * @return the area of the tile, in scene coordinates
+	 */
+	static QRectF area(const Key& key);
+	/**
+	 * @brief Starts rendering a tile in the background.
+	 *
+	 * @param key the tile
+	 */
+	void request(const Key& key);
+
+	/**
+	 * @brief the diagram rendered
+	 */
+	const Graph* _graph;
+	/**
+	 * @brief the tiles rendered, the cost of each being its size in bytes
+	 */
+	QCache<Key,QImage> _tiles;
+	/**
+	 * @brief the tiles being rendered
+	 */
+	QHash<QFutureWatcher<QImage>*,Request> _requests;
+	/**
+	 * @brief the tiles being rendered, for a quick lookup
+	 */
+	QSet<Key> _pending;
+	/**
+	 * @brief the state of the diagram from which the tiles are rendered
+	 */
+	SceneSnapshot _snapshot;
+	/**
+	 * @brief whether the diagram has changed since the snapshot was taken
+	 */
+	bool _snapshotDirty = true;
+};
+
+#endif // TILECACHE_H
@@ -9,6 +9,7 @@
 #include <QGraphicsView>
 #include <types.h>
 #include "viewer.h"
+#include "diagramstore.h"
 #include "drawing.h"
 #include "ui_viewer.h"
 #include "hyperlinkactivatedevent.h"
@@ -18,7 +19,6 @@
 #include "sourcetextviewer.h"
 
 quint64 Viewer::_graphsIdGenerator = 1;
-GVC_t* Viewer::GRAPHVIZ_CONTEXT = gvContext();
 
 Viewer::Viewer(QWidget *parent) :
 	QMainWindow(parent),
@@ -92,7 +92,7 @@ void Viewer::openGraph(const QString& filename)
 	qDebug() << "About to open: " << filename;
 	if (!filename.isEmpty()) {
 		QFileInfo file(filename);
-		if (!file.exists()) {
+		if (!DiagramStore::instance().exists(filename)) {
 			QMessageBox::critical(this, tr("Kayrebt::Viewer"), tr("The file you have selected does not exist."));
 			return;
 		}
@@ -108,7 +108,7 @@ void Viewer::openGraph(const QString& filename)
 
 quint64 Viewer::doOpenGraph(const QFileInfo& file)
 {
-	QString newFileName(file.canonicalFilePath());
+	QString newFileName(DiagramStore::instance().canonicalPath(file.filePath()));
 	quint64 id = 0;
 
 	bool found = false;
@@ -138,7 +138,7 @@ bool Viewer::event(QEvent *event)
 	if (event->type() == HyperlinkActivatedEvent::HYPERLINK_ACTIVATED_EVENT) {
 		HyperlinkActivatedEvent* realEvent = static_cast<HyperlinkActivatedEvent*>(event);
 		QFileInfo file(realEvent->getUrl());
-		if (!file.exists()) {
+		if (!DiagramStore::instance().exists(file.filePath())) {
 			QMessageBox::critical(this, tr("Kayrebt::Viewer"), tr("The diagram you want does not exist.\n"
 																  "Perhaps it is a compiler-generated symbol?\n"));
 		} else {
@@ -166,6 +166,5 @@ bool Viewer::event(QEvent *event)
 
 Viewer::~Viewer()
 {
-	gvFreeContext(GRAPHVIZ_CONTEXT); //safe, at this point, all the graphs are already closed
 	delete ui;
 }